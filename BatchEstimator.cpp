@@ -0,0 +1,111 @@
+#include "BatchEstimator.h"
+#include "Statistics.h"
+
+/*!
+ *  Constructor
+ *  \param type estimation: MOMENT, MLE (the Newton fit, MLE_NEWTON),
+ *  MLE_UNCONSTRAINED, MLE_CONSTRAINED, MML_SCALE or MML
+ *  \param num_threads the number of worker threads
+ */
+BatchEstimator::BatchEstimator(string type, int num_threads) :
+                               type(type), pool(num_threads)
+{
+  if (type.compare("MLE") == 0) {
+    this->type = "MLE_NEWTON";
+  }
+  assert(this->type.compare("MOMENT") == 0 ||
+         this->type.compare("MLE_UNCONSTRAINED") == 0 ||
+         this->type.compare("MLE_CONSTRAINED") == 0 ||
+         this->type.compare("MLE_NEWTON") == 0 ||
+         this->type.compare("MML_SCALE") == 0 ||
+         this->type.compare("MML") == 0);
+}
+
+int BatchEstimator::numThreads()
+{
+  return pool.size();
+}
+
+/*!
+ *  \brief Checks that the statistics come from a sample of 3D unit
+ *  vectors: N > 0 and |\sum x| <= N.
+ */
+int BatchEstimator::validate(struct SufficientStatistics &stats)
+{
+  if (stats.sum_x.size() != 3 || stats.sum_xx.size1() != 3 ||
+      stats.sum_xx.size2() != 3) {
+    return FIT_INVALID_STATISTICS;
+  }
+  if (!(stats.N > 0)) {
+    return FIT_INVALID_STATISTICS;
+  }
+  long double trace = 0;
+  for (int i=0; i<3; i++) {
+    if (!std::isfinite(stats.sum_x[i])) return FIT_INVALID_STATISTICS;
+    trace += stats.sum_xx(i,i);
+  }
+  // trace(\sum x x') = N for unit vectors
+  if (fabs(trace - stats.N) > 1e-6 * stats.N) {
+    return FIT_INVALID_STATISTICS;
+  }
+  if (norm(stats.sum_x) > stats.N * (1 + TOLERANCE)) {
+    return FIT_INVALID_STATISTICS;
+  }
+  return FIT_OK;
+}
+
+/*!
+ *  \brief Runs one fit.
+ *  \return its status
+ */
+int BatchEstimator::fit(struct SufficientStatistics &stats, struct Estimates &estimates)
+{
+  int status = validate(stats);
+  if (status != FIT_OK) {
+    return status;
+  }
+  estimates = computeEstimates(stats,type);
+  bool finite = std::isfinite(estimates.kappa) && std::isfinite(estimates.beta);
+  for (int i=0; i<3 && finite; i++) {
+    finite = std::isfinite(estimates.mean[i]) &&
+             std::isfinite(estimates.major_axis[i]) &&
+             std::isfinite(estimates.minor_axis[i]);
+  }
+  return finite ? FIT_OK : FIT_NOT_FINITE;
+}
+
+/*!
+ *  \brief Fits every set of statistics. The fits are queued in chunks of
+ *  BATCH_CHUNK_SIZE; idle workers steal chunks from busy ones, which
+ *  evens out the cost of the slow (badly conditioned) fits.
+ *  \param stats a reference to the statistics of each dataset
+ *  \param estimates a reference to the estimates (resized to match)
+ *  \param status a reference to the status of each fit (FIT_OK, ...)
+ *  \return the number of successful fits
+ */
+int BatchEstimator::estimate(
+  std::vector<struct SufficientStatistics> &stats,
+  std::vector<struct Estimates> &estimates,
+  std::vector<int> &status
+) {
+  int num_fits = stats.size();
+  estimates.resize(num_fits);
+  status.assign(num_fits,FIT_INVALID_STATISTICS);
+  for (int first=0; first<num_fits; first+=BATCH_CHUNK_SIZE) {
+    int last = first + BATCH_CHUNK_SIZE;
+    if (last > num_fits) last = num_fits;
+    pool.submit([this,&stats,&estimates,&status,first,last] {
+      for (int i=first; i<last; i++) {
+        status[i] = fit(stats[i],estimates[i]);
+      }
+    });
+  }
+  pool.wait();
+
+  int num_ok = 0;
+  for (int i=0; i<num_fits; i++) {
+    if (status[i] == FIT_OK) num_ok++;
+  }
+  return num_ok;
+}
+
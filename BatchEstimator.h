@@ -0,0 +1,46 @@
+#ifndef BATCH_ESTIMATOR_H
+#define BATCH_ESTIMATOR_H
+
+#include "Header.h"
+#include "Support.h"
+#include "ThreadPool.h"
+
+// status of each fit in a batch
+#define FIT_OK 0
+#define FIT_INVALID_STATISTICS 1  // not 3D, N <= 0 or not unit vectors
+#define FIT_NOT_FINITE 2          // the optimizer returned NaN/inf
+
+// fits handed to the pool in one task
+#define BATCH_CHUNK_SIZE 16
+
+/*!
+ *  Fits a Kent distribution to each of many independent sets of
+ *  sufficient statistics. The fits are spread over a work-stealing
+ *  thread pool that is kept for the lifetime of the estimator, so a
+ *  sequence of batches does not pay for thread creation each time.
+ */
+class BatchEstimator
+{
+  private:
+    string type;
+
+    ThreadPool pool;
+
+    int validate(struct SufficientStatistics &);
+
+    int fit(struct SufficientStatistics &, struct Estimates &);
+
+  public:
+    BatchEstimator(string, int);
+
+    int estimate(
+      std::vector<struct SufficientStatistics> &,
+      std::vector<struct Estimates> &,
+      std::vector<int> &
+    );
+
+    int numThreads();
+};
+
+#endif
+
@@ -0,0 +1,152 @@
+#ifndef DUAL_H
+#define DUAL_H
+
+#include "Header.h"
+
+/*!
+ *  A dual number x + sum_i dx_i e_i (e_i e_j = 0) for forward mode
+ *  automatic differentiation: arithmetic on it carries the value and its
+ *  N partial derivatives, so a function of N seeded variables
+ *  (variable()) returns its value and exact gradient in one pass.
+ *  Comparisons look at the value only.
+ */
+template <int N>
+class Dual
+{
+  public:
+    long double value;
+
+    long double d[N];
+
+    Dual() : value(0) {
+      for (int i=0; i<N; i++) d[i] = 0;
+    }
+
+    Dual(long double value) : value(value) {
+      for (int i=0; i<N; i++) d[i] = 0;
+    }
+
+    /*!
+     *  \brief The i-th independent variable, with the given value
+     */
+    static Dual variable(long double value, int i) {
+      Dual x(value);
+      x.d[i] = 1;
+      return x;
+    }
+
+    /*!
+     *  \brief f(x) given f and f' at the value of x (chain rule)
+     */
+    Dual chain(long double f, long double df) const {
+      Dual ans(f);
+      for (int i=0; i<N; i++) ans.d[i] = df * d[i];
+      return ans;
+    }
+
+    Dual operator-() const {
+      Dual ans(-value);
+      for (int i=0; i<N; i++) ans.d[i] = -d[i];
+      return ans;
+    }
+
+    Dual &operator+=(const Dual &y) {
+      value += y.value;
+      for (int i=0; i<N; i++) d[i] += y.d[i];
+      return *this;
+    }
+
+    Dual &operator-=(const Dual &y) {
+      value -= y.value;
+      for (int i=0; i<N; i++) d[i] -= y.d[i];
+      return *this;
+    }
+
+    Dual &operator*=(const Dual &y) {
+      for (int i=0; i<N; i++) d[i] = d[i] * y.value + value * y.d[i];
+      value *= y.value;
+      return *this;
+    }
+
+    Dual &operator/=(const Dual &y) {
+      long double inv = 1 / y.value;
+      value *= inv;
+      for (int i=0; i<N; i++) d[i] = (d[i] - value * y.d[i]) * inv;
+      return *this;
+    }
+
+    friend Dual operator+(Dual x, const Dual &y) { return x += y; }
+    friend Dual operator-(Dual x, const Dual &y) { return x -= y; }
+    friend Dual operator*(Dual x, const Dual &y) { return x *= y; }
+    friend Dual operator/(Dual x, const Dual &y) { return x /= y; }
+
+    friend Dual operator+(Dual x, long double y) { x.value += y; return x; }
+    friend Dual operator+(long double x, Dual y) { y.value += x; return y; }
+    friend Dual operator-(Dual x, long double y) { x.value -= y; return x; }
+    friend Dual operator-(long double x, const Dual &y) { return -y + x; }
+
+    friend Dual operator*(Dual x, long double y) {
+      x.value *= y;
+      for (int i=0; i<N; i++) x.d[i] *= y;
+      return x;
+    }
+
+    friend Dual operator*(long double x, const Dual &y) { return y * x; }
+    friend Dual operator/(const Dual &x, long double y) { return x * (1 / y); }
+    friend Dual operator/(long double x, const Dual &y) { return Dual(x) / y; }
+
+    friend bool operator<(const Dual &x, const Dual &y) { return x.value < y.value; }
+    friend bool operator>(const Dual &x, const Dual &y) { return x.value > y.value; }
+    friend bool operator<=(const Dual &x, const Dual &y) { return x.value <= y.value; }
+    friend bool operator>=(const Dual &x, const Dual &y) { return x.value >= y.value; }
+
+    friend Dual sin(const Dual &x) { return x.chain(sinl(x.value),cosl(x.value)); }
+    friend Dual cos(const Dual &x) { return x.chain(cosl(x.value),-sinl(x.value)); }
+
+    friend Dual tan(const Dual &x) {
+      long double t = tanl(x.value);
+      return x.chain(t,1 + t * t);
+    }
+
+    friend Dual acos(const Dual &x) {
+      return x.chain(acosl(x.value),-1 / sqrtl(1 - x.value * x.value));
+    }
+
+    friend Dual atan2(const Dual &y, const Dual &x) {
+      long double r2 = x.value * x.value + y.value * y.value;
+      Dual ans(atan2l(y.value,x.value));
+      for (int i=0; i<N; i++) ans.d[i] = (x.value * y.d[i] - y.value * x.d[i]) / r2;
+      return ans;
+    }
+
+    friend Dual sqrt(const Dual &x) {
+      long double s = sqrtl(x.value);
+      return x.chain(s,0.5 / s);
+    }
+
+    friend Dual log(const Dual &x) { return x.chain(logl(x.value),1 / x.value); }
+
+    friend Dual exp(const Dual &x) {
+      long double e = expl(x.value);
+      return x.chain(e,e);
+    }
+
+    friend Dual fabs(const Dual &x) { return (x.value < 0) ? -x : x; }
+};
+
+/*!
+ *  \brief The value of a scalar (the identity for plain numbers)
+ */
+inline long double valueOf(long double x)
+{
+  return x;
+}
+
+template <int N>
+inline long double valueOf(const Dual<N> &x)
+{
+  return x.value;
+}
+
+#endif
+
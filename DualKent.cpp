@@ -0,0 +1,169 @@
+#include "DualKent.h"
+
+/*!
+ *  Null constructor
+ */
+DualKent::DualKent()
+{}
+
+/*!
+ *  \brief A function f of (kappa,beta) with value f and partial
+ *  derivatives dk, db, carried over to the seeded variables
+ */
+KentDual DualKent::scale(long double f, long double dk, long double db)
+{
+  KentDual ans(f);
+  for (int i=0; i<NUM_KENT_PARAMETERS; i++) {
+    ans.d[i] = dk * kappa.d[i] + db * beta.d[i];
+  }
+  return ans;
+}
+
+/*!
+ *  \brief log c and the ratios of its derivatives to c with their
+ *  derivatives. The ratios r(n,s) = F(n,s)/c have
+ *  dr/dk = r(n,s+1) + (s/k) r(n,s) - r(n,s) r(0,1)
+ *  dr/db = r(n+1,s) - r(n,s) r(1,0)
+ *  so the ratios of order 3 give the gradients of those of order 2.
+ */
+void DualKent::computeScaleConstants()
+{
+  long double r[MAX_SCALE_ORDER+1][MAX_SCALE_ORDER+1];
+  series.setScale(kappa.value,beta.value);
+  long double log_c = series.computeLogScaleSeries(3,r);
+  long double k = kappa.value;
+
+  KentDual ratio[3][3];
+  for (int n=0; n<=2; n++) {
+    for (int s=0; n+s<=2; s++) {
+      long double drdk = r[n][s+1] + (s/k) * r[n][s] - r[n][s] * r[0][1];
+      long double drdb = r[n+1][s] - r[n][s] * r[1][0];
+      ratio[n][s] = scale(r[n][s],drdk,drdb);
+    }
+  }
+  sc.log_c = scale(log_c,r[0][1],r[1][0]);
+  sc.ck_c = ratio[0][1];
+  sc.cb_c = ratio[1][0];
+  sc.ckk_c = ratio[0][2] + ratio[0][1] / kappa;
+  sc.ckb_c = ratio[1][1];
+  sc.cbb_c = ratio[2][0];
+}
+
+/*!
+ *  \brief Sets the parameters (as Kent::setParameters()) and sums the
+ *  series.
+ */
+void DualKent::setParameters(
+  const KentDual &alpha, const KentDual &eta, const KentDual &psi,
+  const KentDual &delta, const KentDual &kappa, const KentDual &beta
+) {
+  this->alpha = alpha;
+  this->kappa = kappa;
+  this->beta = beta;
+  computeTrignometryConstants(alpha,eta,psi,delta,tc);
+  computeAxes(tc,mu,mj,mi);
+  computeScaleConstants();
+}
+
+/*!
+ *  \brief Sets the parameters from the mean and the major axis (as
+ *  Kent::setAxes()).
+ */
+void DualKent::setAxes(
+  const KentDual *m0, const KentDual *m1, const KentDual &kappa, const KentDual &beta
+) {
+  KentDual z0 = m0[2],z1 = m1[2];
+  if (z0 > 1) z0 = 1; else if (z0 < -1) z0 = -1;
+  if (z1 > 1) z1 = 1; else if (z1 < -1) z1 = -1;
+  KentDual alpha = acos(z0);
+  KentDual eta = atan2(m0[1],m0[0]);
+  KentDual psi = acos(z1);
+  KentDual delta = atan2(m1[1],m1[0]);
+  setParameters(alpha,eta,psi,delta,kappa,beta);
+}
+
+/*!
+ *  \brief N log c(k,b) - k (m0' x) - b (mj' xx' mj - mi' xx' mi)
+ *  (Kent::computeNegativeLogLikelihood())
+ */
+KentDual DualKent::negativeLogLikelihood(const Vector &sample_mean, const Matrix &S, long double N)
+{
+  const long double *s = &S.data()[0];
+  KentDual c1 = dot3(mu,&sample_mean[0]);
+  KentDual c2 = prod_xMy3(mj,s,mj) - prod_xMy3(mi,s,mi);
+  return N * sc.log_c - kappa * c1 - beta * c2;
+}
+
+KentDual DualKent::logPriorProbability()
+{
+  return computeLogPriorAxes(alpha) + computeLogPriorScale(kappa);
+}
+
+/*!
+ *  \brief log det of the Fisher matrix of the angles, given the moments
+ */
+KentDual DualKent::logFisherAxes(KentDual *E_x, KentDual *E_xx)
+{
+  KentDual kappa_E_x[3],beta_E_xx[9],F[3][3];
+  for (int i=0; i<3; i++) {
+    kappa_E_x[i] = kappa * E_x[i];
+  }
+  for (int i=0; i<9; i++) {
+    beta_E_xx[i] = beta * E_xx[i];
+  }
+  computeAxesDifferentials(tc,mu,mj,0,2,df);
+  computeFisherMatrixAxes(kappa_E_x,beta_E_xx,mj,mi,df,F);
+  return log(determinant3(F));
+}
+
+/*!
+ *  \brief log det of the Fisher information of N observations
+ *  (Kent::computeLogFisherInformation(N)); NaN where the second moments
+ *  are not all positive.
+ */
+KentDual DualKent::logFisherInformation(long double N)
+{
+  KentDual E_x[3],E_xx[9];
+  if (!computeMoments(mu,mj,mi,sc,E_x,E_xx)) {
+    return KentDual(std::numeric_limits<long double>::quiet_NaN());
+  }
+  return logFisherAxes(E_x,E_xx) + computeLogFisherScale(sc) + 5 * log(N);
+}
+
+/*!
+ *  \brief The message length minimized by MMLObjectiveFunction:
+ *  (5/2) log(kd) - log h + 0.5 log det(fisher) + L + 5/2 - 2 N log(AOM)
+ */
+KentDual DualKent::messageLength(const Vector &sample_mean, const Matrix &S, long double N)
+{
+  long double kd = 1;  // as MMLObjectiveFunction
+  KentDual part1 = 2.5 * log(kd) - logPriorProbability() + 0.5 * logFisherInformation(N);
+  KentDual part2 = negativeLogLikelihood(sample_mean,S,N) + 2.5 - 2 * N * log(AOM);
+  return part1 + part2;
+}
+
+/*!
+ *  \brief KL divergence of another Kent distribution from this one
+ *  (Kent::computeKLDivergence()); the other distribution is constant.
+ */
+KentDual DualKent::klDivergence(Kent &other)
+{
+  KentDual E_x[3],E_xx[9];
+  if (!computeMoments(mu,mj,mi,sc,E_x,E_xx)) {
+    return KentDual(std::numeric_limits<long double>::quiet_NaN());
+  }
+  long double kappa2 = other.Kappa(),beta2 = other.Beta();
+  Vector m0 = other.Mean(),m1 = other.MajorAxis(),m2 = other.MinorAxis();
+  KentDual kmu[3],mj2[3],mi2[3];
+  for (int i=0; i<3; i++) {
+    kmu[i] = kappa * mu[i] - kappa2 * m0[i];
+    mj2[i] = m1[i];
+    mi2[i] = m2[i];
+  }
+  KentDual ans = other.computeLogNormalizationConstant() - sc.log_c;
+  ans += dot3(kmu,E_x);
+  ans += beta * (prod_xMy3(mj,E_xx,mj) - prod_xMy3(mi,E_xx,mi));
+  ans -= beta2 * (prod_xMy3(mj2,E_xx,mj2) - prod_xMy3(mi2,E_xx,mi2));
+  return ans;
+}
+
@@ -0,0 +1,65 @@
+#ifndef DUAL_KENT_H
+#define DUAL_KENT_H
+
+#include "Header.h"
+#include "Dual.h"
+#include "KentMath.h"
+#include "Kent.h"
+
+#define NUM_KENT_PARAMETERS 5
+
+typedef Dual<NUM_KENT_PARAMETERS> KentDual;
+
+/*!
+ *  The Kent objectives evaluated on dual numbers: the parameters can be
+ *  any functions of NUM_KENT_PARAMETERS seeded variables (the angles,
+ *  a rotation vector, a reparameterized scale, ...) and the negative log
+ *  likelihood, the message length and the KL divergence come out with
+ *  their exact gradients in one pass. The axes, their differentials, the
+ *  moments and the Fisher matrices are the templates of KentMath.h; the
+ *  series of the normalization constant are summed once, at the value of
+ *  (kappa,beta), to third order and their derivatives follow from the
+ *  ratios r(n,s) = F(n,s)/c (Kent::computeLogScaleSeries()).
+ */
+class DualKent
+{
+  private:
+    Kent series;    // sums the series at the value of (kappa,beta)
+
+    KentDual alpha,kappa,beta;
+
+    TrignometryConstants<KentDual> tc;
+
+    KentDual mu[3],mj[3],mi[3];
+
+    ScaleConstants<KentDual> sc;
+
+    AxesDifferentials<KentDual> df;
+
+    KentDual scale(long double, long double, long double);
+
+    void computeScaleConstants();
+
+    KentDual logFisherAxes(KentDual *, KentDual *);
+
+  public:
+    DualKent();
+
+    void setParameters(const KentDual &, const KentDual &, const KentDual &,
+                       const KentDual &, const KentDual &, const KentDual &);
+
+    void setAxes(const KentDual *, const KentDual *, const KentDual &, const KentDual &);
+
+    KentDual negativeLogLikelihood(const Vector &, const Matrix &, long double);
+
+    KentDual logPriorProbability();
+
+    KentDual logFisherInformation(long double);
+
+    KentDual messageLength(const Vector &, const Matrix &, long double);
+
+    KentDual klDivergence(Kent &);
+};
+
+#endif
+
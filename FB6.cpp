@@ -95,7 +95,7 @@ std::vector<Vector> FB6::generateCanonical(int sample_size)
       // step 3
       s2 = rand()/(long double)RAND_MAX;
       tmp = beta * (1-u1[0]*u1[0]);
-      num = cyl_bessel_i(0,tmp);
+      num = boost::math::cyl_bessel_i(0,tmp);
       denom = coshl(tmp);
       if (s2 <= num/denom) {
         u[i] = u1[0];
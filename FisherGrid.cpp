@@ -0,0 +1,162 @@
+#include "FisherGrid.h"
+
+#include <map>
+
+/*!
+ *  Null constructor: one thread per OpenMP thread
+ */
+FisherGrid::FisherGrid() : num_threads(omp_get_max_threads())
+{}
+
+FisherGrid::FisherGrid(int num_threads) : num_threads(num_threads)
+{
+  if (this->num_threads < 1) this->num_threads = 1;
+}
+
+int FisherGrid::numThreads()
+{
+  return num_threads;
+}
+
+/*!
+ *  \brief delta from cos(delta-eta) = -cot(alpha) cot(psi)
+ *  \return false if the angles admit no major axis
+ */
+bool FisherGrid::computeDelta(
+  long double alpha, long double eta, long double psi, long double &delta
+) {
+  long double tmp = -1/(tan(alpha) * tan(psi));
+  if (boost::math::isnan(tmp) || fabs(tmp) >= 1) return false;
+  delta = eta + acos(tmp);
+  return true;
+}
+
+bool FisherGrid::isValidScale(long double kappa, long double beta)
+{
+  return std::isfinite(kappa) && kappa > 0 && beta >= 0 && 2 * beta < kappa;
+}
+
+/*!
+ *  \brief Sums the series of each valid scale in parallel, so that the
+ *  scales can then be shared (read only) by all the threads.
+ */
+void FisherGrid::computeScales(std::vector<Kent> &scales)
+{
+  #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+  for (long i=0; i<scales.size(); i++) {
+    Kent &scale = scales[i];
+    scale.computeLogFisherScale();
+  }
+}
+
+/*!
+ *  \brief Evaluates the log Fisher information over the grid
+ *  alpha X eta X psi X kappa X beta. The orientations are spread over the
+ *  threads; each thread sets up an orientation once and runs through all
+ *  the (precomputed) scales.
+ *  \param alpha the grid values of alpha
+ *  \param eta the grid values of eta
+ *  \param psi the grid values of psi
+ *  \param kappa the grid values of kappa
+ *  \param beta the grid values of beta
+ *  \param log_fisher the values, row-major with beta varying fastest:
+ *  index (((i_alpha * |eta| + i_eta) * |psi| + i_psi) * |kappa| + i_kappa)
+ *  * |beta| + i_beta
+ */
+void FisherGrid::evaluate(
+  std::vector<long double> &alpha,
+  std::vector<long double> &eta,
+  std::vector<long double> &psi,
+  std::vector<long double> &kappa,
+  std::vector<long double> &beta,
+  std::vector<long double> &log_fisher
+) {
+  long num_scales = kappa.size() * beta.size();
+  long num_orientations = alpha.size() * eta.size() * psi.size();
+  log_fisher.assign(num_orientations * num_scales,
+                    std::numeric_limits<long double>::quiet_NaN());
+
+  std::vector<Kent> scales;
+  std::vector<int> valid;
+  scales.reserve(num_scales);
+  for (int i=0; i<kappa.size(); i++) {
+    for (int j=0; j<beta.size(); j++) {
+      bool ok = isValidScale(kappa[i],beta[j]);
+      scales.push_back(ok ? Kent(kappa[i],beta[j]) : Kent());
+      valid.push_back(ok);
+    }
+  }
+  computeScales(scales);
+
+  long num_eta = eta.size(), num_psi = psi.size();
+  #pragma omp parallel num_threads(num_threads)
+  {
+    Kent kent;
+    #pragma omp for schedule(dynamic)
+    for (long o=0; o<num_orientations; o++) {
+      long double a = alpha[o / (num_eta * num_psi)];
+      long double n = eta[(o / num_psi) % num_eta];
+      long double s = psi[o % num_psi];
+      long double delta;
+      if (!computeDelta(a,n,s,delta)) continue;
+      // the scale is replaced below: (1,0) is a placeholder
+      kent.setParameters(a,n,s,delta,1,0);
+      long double *values = &log_fisher[o * num_scales];
+      for (long i=0; i<num_scales; i++) {
+        if (!valid[i]) continue;
+        kent.setScale(scales[i]);
+        values[i] = kent.computeLogFisherInformation();
+      }
+    }
+  }
+}
+
+/*!
+ *  \brief Evaluates the log Fisher information at arbitrary parameters.
+ *  Each distinct (kappa,beta) is summed once; the points are split into
+ *  contiguous blocks, one per thread, so that consecutive points with
+ *  the same angles (as in a grid ordered by orientation) reuse the
+ *  orientation.
+ *  \param parameters each a Vector (alpha,eta,psi,kappa,beta)
+ *  \param log_fisher the values
+ */
+void FisherGrid::evaluate(
+  std::vector<Vector> &parameters, std::vector<long double> &log_fisher
+) {
+  long num_points = parameters.size();
+  log_fisher.assign(num_points,std::numeric_limits<long double>::quiet_NaN());
+
+  std::map<std::pair<long double,long double>,int> index;
+  std::vector<Kent> scales;
+  std::vector<int> scale_index(num_points,-1);
+  for (long i=0; i<num_points; i++) {
+    assert(parameters[i].size() == 5);
+    long double kappa = parameters[i][3], beta = parameters[i][4];
+    if (!isValidScale(kappa,beta)) continue;
+    std::pair<long double,long double> key(kappa,beta);
+    std::map<std::pair<long double,long double>,int>::iterator it = index.find(key);
+    if (it == index.end()) {
+      it = index.insert(std::make_pair(key,(int)scales.size())).first;
+      scales.push_back(Kent(kappa,beta));
+    }
+    scale_index[i] = it->second;
+  }
+  computeScales(scales);
+
+  #pragma omp parallel num_threads(num_threads)
+  {
+    Kent kent;
+    #pragma omp for schedule(static)
+    for (long i=0; i<num_points; i++) {
+      if (scale_index[i] < 0) continue;
+      Vector &x = parameters[i];
+      long double delta;
+      if (!computeDelta(x[0],x[1],x[2],delta)) continue;
+      // keeps the orientation if the angles are those of the last point
+      kent.setParameters(x[0],x[1],x[2],delta,x[3],x[4]);
+      kent.setScale(scales[scale_index[i]]);
+      log_fisher[i] = kent.computeLogFisherInformation();
+    }
+  }
+}
+
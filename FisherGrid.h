@@ -0,0 +1,50 @@
+#ifndef FISHER_GRID_H
+#define FISHER_GRID_H
+
+#include "Header.h"
+#include "Kent.h"
+
+/*!
+ *  Evaluates log det of the Fisher information of the Kent distribution
+ *  (Kent::computeLogFisherInformation()) at many parameter values at
+ *  once, in parallel over OpenMP threads. The series of the scale
+ *  constants are summed once per distinct (kappa,beta) and the angles
+ *  (trignometry constants, axes and their differentials) are set up once
+ *  per orientation; each evaluation only combines the two.
+ *  The parameters are (alpha,eta,psi,kappa,beta) with delta solved from
+ *  cos(delta-eta) = -cot(alpha) cot(psi); where there is no such delta,
+ *  or (kappa,beta) is not a valid scale (0 <= 2 beta < kappa), the value
+ *  is NaN.
+ */
+class FisherGrid
+{
+  private:
+    int num_threads;
+
+    bool computeDelta(long double, long double, long double, long double &);
+
+    bool isValidScale(long double, long double);
+
+    void computeScales(std::vector<Kent> &);
+
+  public:
+    FisherGrid();
+
+    FisherGrid(int);
+
+    void evaluate(
+      std::vector<long double> &,
+      std::vector<long double> &,
+      std::vector<long double> &,
+      std::vector<long double> &,
+      std::vector<long double> &,
+      std::vector<long double> &
+    );
+
+    void evaluate(std::vector<Vector> &, std::vector<long double> &);
+
+    int numThreads();
+};
+
+#endif
+
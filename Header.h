@@ -58,6 +58,7 @@ typedef number<mpfr_float_backend<1000> > my_float;
 #define LOG_PI log(PI)
 #define ZERO std::numeric_limits<long double>::epsilon()
 #define TOLERANCE 1e-8
+#define BESSEL_UNIFORM_ORDER 15  // log I_v(x) by the uniform expansion from this v
 
 #define SET 1 
 #define UNSET 0
@@ -67,6 +68,11 @@ typedef number<mpfr_float_backend<1000> > my_float;
 #define MLE_CONSTRAINED 3 
 #define MML_SCALE 4
 #define MML 5
+#define MLE_NEWTON 6
+
+// orientation parameters of the 5-parameter objectives
+#define ANGLES 1           // (alpha,eta,psi); delta solved from them
+#define ROTATION_VECTOR 2  // rotation of the initial frame
 
 #define PRINT_NON_DETAIL 0
 #define PRINT_DETAIL 1
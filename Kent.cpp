@@ -4,6 +4,9 @@
 
 extern Vector XAXIS,YAXIS,ZAXIS;
 
+// series summed for the normalization constant or its derivatives (per thread)
+static thread_local long normalizer_evaluations = 0;
+
 /*!
  *  Null constructor
  */
@@ -12,6 +15,11 @@ Kent::Kent() : kappa(1), beta(0)
   mu = ZAXIS;
   major_axis = XAXIS;
   minor_axis = YAXIS;
+  alpha = eta = psi = delta = std::numeric_limits<long double>::quiet_NaN();
+  computed = UNSET;
+  scale_computed = UNSET;
+  orientation_computed = UNSET;
+  differentials_computed = 0;
 }
 
 /*!
@@ -23,6 +31,11 @@ Kent::Kent(long double kappa, long double beta) : kappa(kappa), beta(beta)
   major_axis = XAXIS;
   minor_axis = YAXIS;
   //assert(eccentricity() < 1);
+  alpha = eta = psi = delta = std::numeric_limits<long double>::quiet_NaN();
+  computed = UNSET;
+  scale_computed = UNSET;
+  orientation_computed = UNSET;
+  differentials_computed = 0;
 }
 
 /*!
@@ -33,46 +46,122 @@ Kent::Kent(Vector &mu, Vector &major_axis, Vector &minor_axis,
           major_axis(major_axis), minor_axis(minor_axis), kappa(kappa), beta(beta)
 {
   //assert(eccentricity() < 1);
+  alpha = eta = psi = delta = std::numeric_limits<long double>::quiet_NaN();
   computed = UNSET;
+  scale_computed = UNSET;
+  orientation_computed = UNSET;
+  differentials_computed = 0;
 }
 
 Kent::Kent(long double alpha, long double eta, long double psi, long double delta, 
-           long double kappa, long double beta) : alpha(alpha), eta(eta), psi(psi), 
-           delta(delta), kappa(kappa), beta(beta)
+           long double kappa, long double beta)
 {
   //assert(eccentricity() < 1);
-  Vector spherical(3,1);
-  mu = Vector(3,0);
-  // compute mu
-  spherical[1] = alpha; spherical[2] = eta;
-  spherical2cartesian(spherical,mu);
-  // compute major_axis
-  spherical[1] = psi;
-  spherical[2] = delta;
-  major_axis = Vector(3,0);
-  spherical2cartesian(spherical,major_axis);
-  // compute minor_axis
-  minor_axis = crossProduct(mu,major_axis);
-
-  // pre-compute trignometry constants
-  tc.cos_alpha = cos(alpha);
-  tc.sin_alpha = sin(alpha);
-  tc.tan_alpha = tan(alpha);
-
-  tc.cos_eta = cos(eta);
-  tc.sin_eta = sin(eta);
-
-  tc.cos_delta = cos(delta);
-  tc.sin_delta = sin(delta);
-
-  tc.d_n = delta - eta;
-  tc.cos_d_n = cos(tc.d_n);
-  tc.sin_d_n = sin(tc.d_n);
-
-  tc.cos_psi = cos(psi);
-  tc.sin_psi = sin(psi);
-  tc.tan_psi = tan(psi);
+  this->alpha = std::numeric_limits<long double>::quiet_NaN();
+  scale_computed = UNSET;
+  orientation_computed = UNSET;
+  differentials_computed = 0;
+  setParameters(alpha,eta,psi,delta,kappa,beta);
+}
+
+/*!
+ *  \brief Re-parameterizes the distribution in place: the storage of the
+ *  axes (and of the constants and differentials computed later) is reused, 
+ *  so an object updated this way does no heap allocation.
+ *  What has been computed is kept for the block of parameters that is 
+ *  unchanged: the scale constants if (kappa,beta) is the same, the 
+ *  orientation constants and the differentials of the axes if 
+ *  (alpha,eta,psi,delta) is the same (as for the probes of a numerical
+ *  derivative, which change one coordinate at a time).
+ */
+void Kent::setParameters(long double alpha, long double eta, long double psi, 
+                         long double delta, long double kappa, long double beta)
+{
+  bool same_axes = alpha == this->alpha && eta == this->eta 
+                   && psi == this->psi && delta == this->delta;
+  bool same_scale = kappa == this->kappa && beta == this->beta;
+  if (same_axes && same_scale) {
+    return;
+  }
   computed = UNSET;
+  if (!same_scale) {
+    this->kappa = kappa;
+    this->beta = beta;
+    scale_computed = UNSET;
+  }
+  if (same_axes) {
+    return;
+  }
+  this->alpha = alpha;
+  this->eta = eta;
+  this->psi = psi;
+  this->delta = delta;
+  orientation_computed = UNSET;
+  differentials_computed = 0;
+
+  computeTrignometryConstants(alpha,eta,psi,delta,tc);
+  if (mu.size() != 3) mu = Vector(3,0);
+  if (major_axis.size() != 3) major_axis = Vector(3,0);
+  if (minor_axis.size() != 3) minor_axis = Vector(3,0);
+  computeAxes(tc,&mu[0],&major_axis[0],&minor_axis[0]);
+}
+
+/*!
+ *  \brief Re-parameterizes the distribution from its mean and major axis
+ *  (orthogonal unit vectors); the angles are recovered from the vectors, 
+ *  so unlike the angles themselves the axes can take any orientation.
+ */
+void Kent::setAxes(const Vector &m0, const Vector &m1, long double kappa, long double beta)
+{
+  long double z0 = m0[2],z1 = m1[2];
+  if (z0 > 1) z0 = 1; else if (z0 < -1) z0 = -1;
+  if (z1 > 1) z1 = 1; else if (z1 < -1) z1 = -1;
+  long double alpha = acos(z0);
+  long double eta = atan2(m0[1],m0[0]);
+  long double psi = acos(z1);
+  long double delta = atan2(m1[1],m1[0]);
+  setParameters(alpha,eta,psi,delta,kappa,beta);
+}
+
+/*!
+ *  \brief Changes kappa and beta keeping the axes: the orientation
+ *  constants stay valid.
+ */
+void Kent::setScale(long double kappa, long double beta)
+{
+  this->kappa = kappa;
+  this->beta = beta;
+  computed = UNSET;
+  scale_computed = UNSET;
+}
+
+/*!
+ *  \brief Changes kappa and beta to those of another distribution and 
+ *  takes its scale constants instead of summing the series again 
+ *  (the orientation constants stay valid). The source computes its 
+ *  constants first if it has not yet, so a source shared between threads
+ *  should have them computed beforehand.
+ */
+void Kent::setScale(Kent &source)
+{
+  if (source.scale_computed != SET) {
+    source.computeScaleConstants();
+  }
+  kappa = source.kappa;
+  beta = source.beta;
+  constants.log_c = source.constants.log_c;
+  constants.log_ck = source.constants.log_ck;
+  constants.log_cb = source.constants.log_cb;
+  constants.log_ckk = source.constants.log_ckk;
+  constants.log_ckb = source.constants.log_ckb;
+  constants.log_cbb = source.constants.log_cbb;
+  constants.ck_c = source.constants.ck_c;
+  constants.cb_c = source.constants.cb_c;
+  constants.ckk_c = source.constants.ckk_c;
+  constants.ckb_c = source.constants.ckb_c;
+  constants.cbb_c = source.constants.cbb_c;
+  computed = UNSET;
+  scale_computed = SET;
 }
 
 /*!
@@ -92,6 +181,9 @@ Kent Kent::operator=(const Kent &source)
     beta = source.beta;
     constants = source.constants;
     computed = source.computed;
+    scale_computed = source.scale_computed;
+    orientation_computed = source.orientation_computed;
+    differentials_computed = source.differentials_computed;
     df = source.df;
     tc = source.tc;
   }
@@ -133,6 +225,15 @@ Kent::Constants Kent::getConstants()
   return constants;
 }
 
+/*!
+ *  \brief The number of series (normalization constant and its 
+ *  derivatives) summed so far by the calling thread
+ */
+long Kent::normalizerEvaluations()
+{
+  return normalizer_evaluations;
+}
+
 /*!
  *  Normalization constant
  */
@@ -146,13 +247,19 @@ long double Kent::log_dc_dk(void)
   return computeSeriesSum(kappa,beta,1.5);
 }
 
+/*!
+ *  \brief log c_kk: c_kk = F(0,2) + F(0,1)/k (see computeLogDerivativeSeries())
+ */
 long double Kent::log_d2c_dk2(void)
 {
-  return computeSeriesSum(kappa,beta,2.5);
+  long double log_f02 = computeSeriesSum(kappa,beta,2.5);
+  long double log_f01 = computeSeriesSum(kappa,beta,1.5);
+  return log_f02 + log1p(exp(log_f01 - log_f02) / kappa);
 }
 
 long double Kent::computeSeriesSum(long double k, long double b, long double d)
 {
+  normalizer_evaluations++;
   long double ex = 2 * b/k; 
   long double log_ex = 2 * log(ex);
   //long double log_bessel = logModifiedBesselFirstKind(0,k);
@@ -162,12 +269,12 @@ long double Kent::computeSeriesSum(long double k, long double b, long double d)
   int j = 0;
   long double gj;
 
-  log_bessel_prev = log(cyl_bessel_i(d,k));
+  log_bessel_prev = log(boost::math::cyl_bessel_i(d,k));
   log_f0 = lgamma<long double>(0.5) + log_bessel_prev;
   log_fj_prev = log_f0;
   while (1) {
     d += 2;
-    log_bessel_current = log(cyl_bessel_i(d,k));
+    log_bessel_current = log(boost::math::cyl_bessel_i(d,k));
     gj = log_bessel_current - log_bessel_prev;
     gj += log_ex;
     gj += (log(j+0.5) - log(j+1));
@@ -203,6 +310,7 @@ long double Kent::log_d2c_dkdb()
 
 long double Kent::computeSeriesSum2(long double k, long double b, long double d)
 {
+  normalizer_evaluations++;
   long double ex = 2 * b/k; 
   long double log_ex = 2 * log(ex);
   long double log_bessel_prev,log_bessel_current;
@@ -211,12 +319,12 @@ long double Kent::computeSeriesSum2(long double k, long double b, long double d)
   int j = 1;
   long double gj;
 
-  log_bessel_prev = log(cyl_bessel_i(d,k));
+  log_bessel_prev = log(boost::math::cyl_bessel_i(d,k));
   log_f1 = lgamma<long double>(1.5) + log_ex + log_bessel_prev;
   log_fj_prev = log_f1;
   while (1) {
     d += 2;
-    log_bessel_current = log(cyl_bessel_i(d,k));
+    log_bessel_current = log(boost::math::cyl_bessel_i(d,k));
     gj = log_bessel_current - log_bessel_prev;
     gj += log_ex;
     gj += (log(j+0.5) - log(j));
@@ -241,6 +349,7 @@ long double Kent::computeSeriesSum2(long double k, long double b, long double d)
 
 long double Kent::log_d2c_db2()
 {
+  normalizer_evaluations++;
   long double b = beta;
   long double k = kappa;
   long double ex = 2 * b/k; 
@@ -252,12 +361,12 @@ long double Kent::log_d2c_db2()
   int j = 1;
   long double gj;
 
-  log_bessel_prev = log(cyl_bessel_i(d,k));
+  log_bessel_prev = log(boost::math::cyl_bessel_i(d,k));
   log_f1 = lgamma<long double>(1.5) + log_ex + log_bessel_prev;
   log_fj_prev = log_f1;
   while (1) {
     d += 2;
-    log_bessel_current = log(cyl_bessel_i(d,k));
+    log_bessel_current = log(boost::math::cyl_bessel_i(d,k));
     gj = log_bessel_current - log_bessel_prev;
     gj += log_ex;
     gj += (2*log(2*j+1) - log(2*j) - log(2*j-1));
@@ -280,33 +389,192 @@ long double Kent::log_d2c_db2()
   return ans;
 }
 
-void Kent::computeConstants()
+/*!
+ *  \brief Log of the general derivative series
+ *  F(n,s) = 2 pi \sum_j G(j+1/2)/G(j+1) (2j)!/(2j-n)! b^(2j-n) (2/k)^(2j+1/2) I_(2j+1/2+s)(k)
+ *  F(n,0) = d^n c / db^n;  dF(n,s)/db = F(n+1,s);  dF(n,s)/dk = F(n,s+1) + (s/k) F(n,s)
+ *  (c = F(0,0), c_k = F(0,1), c_b = F(1,0), c_kb = F(1,1), c_bb = F(2,0)
+ *  and c_kk = F(0,2) + F(0,1)/k)
+ *  \param n order of the derivative with respect to beta
+ *  \param s shift in the order of the Bessel function
+ */
+long double Kent::computeLogDerivativeSeries(int n, int s)
 {
-  constants.log_c = computeLogNormalizationConstant();
-  constants.log_cb = log_dc_db();
-  constants.log_cbb = log_d2c_db2();
-  constants.log_ck = log_dc_dk();
-  constants.log_ckk = log_d2c_dk2();
-  constants.log_ckb = log_d2c_dkdb();
+  normalizer_evaluations++;
+  long double k = kappa;
+  long double b = beta;
+  long double log_2_k = log(2.0/k);
+  long double log_b = log(b);
+  long double log_f0,log_fj,current,series_sum=1;
+  int j = (n + 1) / 2;
+
+  log_f0 = lgamma<long double>(j+0.5) - lgamma<long double>(j+1) 
+           + lgamma<long double>(2*j+1) - lgamma<long double>(2*j-n+1)
+           + (2*j+0.5) * log_2_k
+           + log(boost::math::cyl_bessel_i(2*j+0.5+s,k));
+  if (2*j > n) log_f0 += (2*j-n) * log_b;
+  log_fj = log_f0;
+  while (1) {
+    j++;
+    // ratio of the consecutive terms
+    log_fj += log(j-0.5) - log(j) 
+              + log(2*j) + log(2*j-1) - log(2*j-n) - log(2*j-n-1)
+              + 2 * (log_b + log_2_k)
+              + log(boost::math::cyl_bessel_i(2*j+0.5+s,k))
+              - log(boost::math::cyl_bessel_i(2*j-1.5+s,k));
+    current = exp(log_fj - log_f0);
+    series_sum += current;
+    if (current/series_sum <= TOLERANCE) {
+      break;
+    }
+  }
+  return log(2*PI) + log_f0 + log(series_sum);
+}
 
-  long double tmp;
-  tmp = constants.log_ck - constants.log_c;
-  constants.ck_c = exp(tmp);
+/*!
+ *  \brief The series F(n,s) of computeLogDerivativeSeries() for all 
+ *  n+s <= order, summed together: the j-th terms of all of them are
+ *  made of the Bessel functions I_(2j+1/2+s)(k), s = 0..order, and 
+ *  each Bessel function is evaluated once (two per j) instead of once
+ *  per series.
+ *  \param order the largest n+s (<= MAX_SCALE_ORDER)
+ *  \param r the ratios r[n][s] = F(n,s)/c for n+s <= order
+ *  \return log c
+ */
+long double Kent::computeLogScaleSeries(
+  int order, long double r[MAX_SCALE_ORDER+1][MAX_SCALE_ORDER+1]
+) {
+  assert(order >= 0 && order <= MAX_SCALE_ORDER);
+  normalizer_evaluations++;
+  long double k = kappa;
+  long double log_2_k = log(2.0/k);
+  long double log_b = log(beta);
+  long double log_bessel[MAX_SCALE_ORDER+1];  // log I_(2j+1/2+s)(k)
+  long double sum[MAX_SCALE_ORDER+1][MAX_SCALE_ORDER+1];
+  for (int n=0; n<=order; n++) {
+    for (int s=0; n+s<=order; s++) {
+      sum[n][s] = 0;
+    }
+  }
+  for (int s=0; s<=order; s++) {
+    log_bessel[s] = log(boost::math::cyl_bessel_i(s+0.5,k));
+  }
 
-  tmp = constants.log_ckk - constants.log_c;
-  constants.ckk_c = exp(tmp);
+  // log of G(j+1/2)/G(j+1) (2/k)^(2j+1/2): common to all the series
+  long double log_common = lgamma<long double>(0.5) + 0.5 * log_2_k;
+  long double log_f0 = log_common + log_bessel[0];  // first term of c
+  int j = 0;
+  while (1) {
+    bool converged = true;
+    for (int n=0; n<=order && n<=2*j; n++) {
+      // log of (2j)!/(2j-n)! b^(2j-n)
+      long double log_coefficient = log_common;
+      for (int i=0; i<n; i++) {
+        log_coefficient += log(2*j-i);
+      }
+      if (2*j > n) log_coefficient += (2*j-n) * log_b;
+      for (int s=0; n+s<=order; s++) {
+        long double current = exp(log_coefficient + log_bessel[s] - log_f0);
+        sum[n][s] += current;
+        if (current > TOLERANCE * sum[n][s] || 2*j < order) {
+          converged = false;
+        }
+      }
+    }
+    if (converged) break;
+    j++;
+    log_common += log(j-0.5) - log(j) + 2 * log_2_k;
+    for (int s=0; s<=order; s++) {
+      if (s + 2 <= order) {
+        log_bessel[s] = log_bessel[s+2];
+      } else {
+        log_bessel[s] = log(boost::math::cyl_bessel_i(2*j+0.5+s,k));
+      }
+    }
+  }
+
+  for (int n=0; n<=order; n++) {
+    for (int s=0; n+s<=order; s++) {
+      r[n][s] = sum[n][s] / sum[0][0];
+    }
+  }
+  return log(2*PI) + log_f0 + log(sum[0][0]);
+}
 
-  tmp = constants.log_cb - constants.log_c;
-  constants.cb_c = exp(tmp);
+/*!
+ *  \brief Gradient of log c(k,b): (c_k/c, c_b/c)
+ */
+Vector Kent::computeGradientLogNormalizationConstant()
+{
+  long double log_c = computeLogNormalizationConstant();
+  Vector gradient(2,0);
+  gradient[0] = exp(log_dc_dk() - log_c);
+  gradient[1] = exp(log_dc_db() - log_c);
+  return gradient;
+}
 
-  tmp = constants.log_cbb - constants.log_c;
-  constants.cbb_c = exp(tmp);
+/*!
+ *  \brief The constants that depend on kappa and beta only: log c and the
+ *  ratios of its derivatives to c, from one pass over the series
+ *  (computeLogScaleSeries()).
+ */
+void Kent::computeScaleConstants()
+{
+  long double r[MAX_SCALE_ORDER+1][MAX_SCALE_ORDER+1];
+  constants.log_c = computeLogScaleSeries(2,r);
+  constants.ck_c = r[0][1];
+  constants.cb_c = r[1][0];
+  constants.ckk_c = r[0][2] + r[0][1]/kappa;
+  constants.ckb_c = r[1][1];
+  constants.cbb_c = r[2][0];
+
+  constants.log_ck = constants.log_c + log(constants.ck_c);
+  constants.log_cb = constants.log_c + log(constants.cb_c);
+  constants.log_ckk = constants.log_c + log(constants.ckk_c);
+  constants.log_ckb = constants.log_c + log(constants.ckb_c);
+  constants.log_cbb = constants.log_c + log(constants.cbb_c);
+  scale_computed = SET;
+}
 
-  tmp = constants.log_ckb - constants.log_c;
-  constants.ckb_c = exp(tmp);
+/*!
+ *  \brief The constants that depend on the axes only: the rotation R from
+ *  the standard frame to the axes and its transpose.
+ */
+void Kent::computeOrientationConstants()
+{
+  // R = [major | mu X major | mu] (as computeOrthogonalTransformation()),
+  // filled in place
+  if (constants.R.size1() != 3) {
+    constants.R = Matrix(3,3);
+    constants.Rt = Matrix(3,3);
+  }
+  for (int i=0; i<3; i++) {
+    constants.R(i,0) = major_axis[i];
+    constants.R(i,2) = mu[i];
+  }
+  constants.R(0,1) = mu[1] * major_axis[2] - mu[2] * major_axis[1];
+  constants.R(1,1) = mu[2] * major_axis[0] - mu[0] * major_axis[2];
+  constants.R(2,1) = mu[0] * major_axis[1] - mu[1] * major_axis[0];
+  for (int i=0; i<3; i++) {
+    for (int j=0; j<3; j++) {
+      constants.Rt(i,j) = constants.R(j,i);
+    }
+  }
+  orientation_computed = SET;
+}
 
-  constants.R = computeOrthogonalTransformation(mu,major_axis);
-  constants.Rt = trans(constants.R);
+/*!
+ *  \brief Brings both parts of the constants up to date; a part that is 
+ *  still valid (the orientation after setScale()) is not recomputed.
+ */
+void Kent::computeConstants()
+{
+  if (scale_computed != SET) {
+    computeScaleConstants();
+  }
+  if (orientation_computed != SET) {
+    computeOrientationConstants();
+  }
 }
 
 /*!
@@ -316,31 +584,40 @@ void Kent::computeConstants()
  */
 void Kent::computeExpectation()
 {
+  if (computed == SET) {
+    return;
+  }
   computeConstants();
 
-  constants.E_x = Vector(3,0);
-  constants.kappa_E_x = Vector(3,0);
+  if (constants.E_x.size() != 3) {
+    constants.E_x = Vector(3,0);
+    constants.kappa_E_x = Vector(3,0);
+    constants.E_xx = Matrix(3,3);
+    constants.beta_E_xx = Matrix(3,3);
+  }
   for (int i=0; i<3; i++) {
     constants.E_x[i] = mu[i] * constants.ck_c;
     constants.kappa_E_x[i] = kappa * constants.E_x[i];
   }
 
-  Matrix expectation_std = ZeroMatrix(3,3);
-  expectation_std(0,0) = 0.5 * (1 - constants.ckk_c + constants.cb_c);  // lambda_1
-  expectation_std(1,1) = 0.5 * (1 - constants.ckk_c - constants.cb_c);  // lambda_2
-  expectation_std(2,2) = constants.ckk_c;  // lambda_3
+  long double lambda[3];
+  lambda[0] = 0.5 * (1 - constants.ckk_c + constants.cb_c);  // lambda_1
+  lambda[1] = 0.5 * (1 - constants.ckk_c - constants.cb_c);  // lambda_2
+  lambda[2] = constants.ckk_c;  // lambda_3
 
-  assert(expectation_std(0,0) > 0);
-  assert(expectation_std(1,1) > 0);
-  assert(expectation_std(2,2) > 0);
-  //cout << "E_std: " << expectation_std << endl;
+  assert(lambda[0] > 0);
+  assert(lambda[1] > 0);
+  assert(lambda[2] > 0);
 
-  Matrix tmp1 = prod(constants.R,expectation_std);
-  constants.E_xx = prod(tmp1,constants.Rt);
-  constants.beta_E_xx = ZeroMatrix(3,3);
+  // E_xx = R diag(lambda) R'
   for (int i=0; i<3; i++) {
     for (int j=0; j<3; j++) {
-      constants.beta_E_xx(i,j) = constants.E_xx(i,j) * beta;
+      long double sum = 0;
+      for (int k=0; k<3; k++) {
+        sum += constants.R(i,k) * lambda[k] * constants.R(j,k);
+      }
+      constants.E_xx(i,j) = sum;
+      constants.beta_E_xx(i,j) = sum * beta;
     }
   }
 
@@ -354,7 +631,7 @@ long double Kent::computeNegativeLogLikelihood(std::vector<Vector> &data)
   return computeNegativeLogLikelihood(sample_mean,S,data.size());
 }
 
-long double Kent::computeNegativeLogLikelihood(Vector &sample_mean, Matrix &S, int N)
+long double Kent::computeNegativeLogLikelihood(const Vector &sample_mean, const Matrix &S, long double N)
 {
   long double c1 = computeDotProduct(sample_mean,mu);
 
@@ -362,12 +639,60 @@ long double Kent::computeNegativeLogLikelihood(Vector &sample_mean, Matrix &S, i
   long double mi = prod_xMy(minor_axis,S,minor_axis);
   long double c2 = mj - mi;
 
-  long double log_norm = computeLogNormalizationConstant();
+  long double log_norm = (scale_computed == SET) ? constants.log_c 
+                         : computeLogNormalizationConstant();
 
   long double ans = N * log_norm - kappa * c1 - beta * c2;
   return ans;
 }
 
+/*!
+ *  \brief The log density at a point:
+ *  -log c(k,b) + k (mu' x) + b ((mj' x)^2 - (mi' x)^2), with log c cached
+ *  with the scale constants.
+ *  \param x a reference to a Vector (3D unit vector)
+ */
+long double Kent::log_density(const Vector &x)
+{
+  if (scale_computed != SET) {
+    computeScaleConstants();
+  }
+  long double a = computeDotProduct(mu,x);
+  long double b = computeDotProduct(major_axis,x);
+  long double c = computeDotProduct(minor_axis,x);
+  return kappa * a + beta * (b - c) * (b + c) - constants.log_c;
+}
+
+/*!
+ *  \brief The log densities of points stored contiguously (row-major, 3
+ *  per point) in double precision. The three projections are fused into
+ *  one SIMD pass over the points: with u = mj + mi and v = mj - mi,
+ *  (mj' x)^2 - (mi' x)^2 = (u' x) (v' x), so a point costs three dot
+ *  products and two multiply-adds.
+ *  \param x the points
+ *  \param rows the number of points
+ *  \param out the rows log densities
+ */
+void Kent::log_density(const double *x, long rows, double *out)
+{
+  if (scale_computed != SET) {
+    computeScaleConstants();
+  }
+  double k0 = kappa * mu[0], k1 = kappa * mu[1], k2 = kappa * mu[2];
+  double u0 = major_axis[0] + minor_axis[0], v0 = beta * (major_axis[0] - minor_axis[0]);
+  double u1 = major_axis[1] + minor_axis[1], v1 = beta * (major_axis[1] - minor_axis[1]);
+  double u2 = major_axis[2] + minor_axis[2], v2 = beta * (major_axis[2] - minor_axis[2]);
+  double log_c = constants.log_c;
+  #pragma omp simd
+  for (long i=0; i<rows; i++) {
+    double x0 = x[3*i], x1 = x[3*i+1], x2 = x[3*i+2];
+    double a = k0 * x0 + k1 * x1 + k2 * x2;
+    double u = u0 * x0 + u1 * x1 + u2 * x2;
+    double v = v0 * x0 + v1 * x1 + v2 * x2;
+    out[i] = a + u * v - log_c;
+  }
+}
+
 long double Kent::computeLogPriorProbability()
 {
   long double log_prior_axes = computeLogPriorAxes();
@@ -378,18 +703,12 @@ long double Kent::computeLogPriorProbability()
 
 long double Kent::computeLogPriorAxes()
 {
-  long double log_prior = 0;
-  log_prior += log(4) - 4*log(PI);
-  log_prior += log(sin(alpha));
-  return log_prior;
+  return ::computeLogPriorAxes(alpha);
 }
 
 long double Kent::computeLogPriorScale()
 {
-  long double log_prior = 0;
-  log_prior += 2 * log(kappa);
-  log_prior -= 2 * log(1+kappa*kappa);
-  return log_prior;
+  return ::computeLogPriorScale(kappa);
 }
 
 long double Kent::computeLogFisherInformation()
@@ -400,276 +719,295 @@ long double Kent::computeLogFisherInformation()
   return log_det_axes + log_det_kb; 
 }
 
-long double Kent::computeLogFisherInformation(int N)
+long double Kent::computeLogFisherInformation(long double N)
 {
   long double log_fisher = computeLogFisherInformation(); 
   return log_fisher + 5 * log(N);
 }
 
+/*!
+ *  \brief The message length of a sample stated with this distribution,
+ *  with each term kept apart (struct MessageLength). The total is the
+ *  function minimized by MMLObjectiveFunction. The distribution must have
+ *  been set from its angles (constructor, setParameters() or setAxes()).
+ *  \param sample_mean a reference to a Vector (\sum x)
+ *  \param S a reference to a Matrix (\sum x x')
+ *  \param N the sample size
+ */
+struct MessageLength Kent::computeMessageLength(
+  const Vector &sample_mean, const Matrix &S, long double N
+) {
+  struct MessageLength ml;
+  ml.log_prior_axes = computeLogPriorAxes();
+  ml.log_prior_scale = computeLogPriorScale();
+  computeExpectation();
+  ml.log_fisher_axes = computeLogFisherAxes();
+  ml.log_fisher_scale = computeLogFisherScale();
+  long double kd = 1;  // as MMLObjectiveFunction
+  ml.lattice = 2.5 * log(kd) + 2.5;
+  updateMessageLength(ml,sample_mean,S,N);
+  return ml;
+}
+
+/*!
+ *  \brief Re-evaluates the terms of a message length that depend on the 
+ *  data (N, the likelihood and the precision) for another sample; the
+ *  terms that depend on the parameters only are kept. Comparing a model
+ *  over many candidate samples this way neither sums the series nor 
+ *  recomputes the Fisher information again.
+ *  \param ml a reference to a MessageLength from computeMessageLength()
+ *  of this distribution, with the parameters unchanged since
+ *  \param sample_mean a reference to a Vector (\sum x)
+ *  \param S a reference to a Matrix (\sum x x')
+ *  \param N the sample size
+ */
+void Kent::updateMessageLength(
+  struct MessageLength &ml, const Vector &sample_mean, const Matrix &S, long double N
+) {
+  ml.N = N;
+  ml.log_fisher_sample_size = 5 * log(N);
+  ml.negative_log_likelihood = computeNegativeLogLikelihood(sample_mean,S,N);
+  ml.precision = -2 * N * log(AOM);
+
+  long double log_fisher = ml.log_fisher_axes + ml.log_fisher_scale 
+                           + ml.log_fisher_sample_size;
+  ml.first_part = -ml.log_prior_axes - ml.log_prior_scale + 0.5 * log_fisher;
+  ml.second_part = ml.negative_log_likelihood + ml.precision;
+  ml.total = ml.first_part + ml.second_part + ml.lattice;
+}
+
+/*!
+ *  \brief Log det of the Fisher matrix of the angles. The differentials of
+ *  the axes are reused while the angles are unchanged; the matrix itself
+ *  also depends on E[x x'] (computeExpectation()).
+ */
 long double Kent::computeLogFisherAxes()
 {
-  computeFirstOrderDifferentials();
-  computeSecondOrderDifferentials();
+  computeDifferentials(2);
   computeFisherMatrixAxes();
   long double det = determinant(df.fisher_axes);
   //cout << "det: " << det << endl; //exit(1);
   return log(det);
 }
 
-void Kent::computeFirstOrderDifferentials()
+/*!
+ *  \brief Brings the differentials of the axes with respect to the angles 
+ *  up to the given order (1 or 2), unless they are already 
+ *  (computeAxesDifferentials()).
+ */
+void Kent::computeDifferentials(int order)
 {
-  std::vector<Vector > first_order(3);
-  Vector d1(3,0);
-
-  // d1_mu[0]: dmu_da
-  d1[0] = tc.cos_alpha * tc.cos_eta;  // d1 y11_da
-  d1[1] = tc.cos_alpha * tc.sin_eta;  // d1 y12_da
-  d1[2] = -tc.sin_alpha;              // d1 y13_da
-  first_order[0] = d1;
-
-  // d1_mu[1]: dmu_dn
-  d1[0] = -tc.sin_alpha * tc.sin_eta;  // d1 y11_dn
-  d1[1] = tc.sin_alpha * tc.cos_eta;   // d1 y12_dn
-  d1[2] = 0;                           // d1 y13_dn
-  first_order[1] = d1;
+  differentials_computed = computeAxesDifferentials(
+    tc,&mu[0],&major_axis[0],differentials_computed,order,df
+  );
+}
 
-  // d1_mu[2]: dmu_ds = 0
-  d1[0] = 0;
-  d1[1] = 0;
-  d1[2] = 0;
-  first_order[2] = d1;
+void Kent::computeFisherMatrixAxes()
+{
+  if (df.fisher_axes.size1() != 3) {
+    df.fisher_axes = ZeroMatrix(3,3);
+  }
+  long double F[3][3];
+  ::computeFisherMatrixAxes(&constants.kappa_E_x[0],&constants.beta_E_xx.data()[0],
+                            &major_axis[0],&minor_axis[0],df,F);
+  for (int i=0; i<3; i++) {
+    for (int j=0; j<3; j++) {
+      df.fisher_axes(i,j) = F[i][j];
+    }
+  }
+}
 
-  df.d1_mu = first_order;
+long double Kent::computeLogFisherScale()
+{
+  if (scale_computed != SET) {
+    computeScaleConstants();
+  }
 
-  computeDeltaDifferentials();
-  // d1_mj[0]: dmj_da
-  d1[0] = -tc.sin_psi * tc.sin_delta * df.ddel_da;
-  d1[1] = tc.sin_psi * tc.cos_delta * df.ddel_da;
-  d1[2] = 0; 
-  first_order[0] = d1;
+  // E [d^2 L / d k^2]
+  long double t1 = constants.ckk_c - (constants.ck_c * constants.ck_c);
 
-  // d1_mj[1]: dmj_dn
-  d1[0] = -tc.sin_psi * tc.sin_delta;
-  d1[1] = tc.sin_psi * tc.cos_delta;
-  d1[2] = 0; 
-  first_order[1] = d1;
+  // E [d^2 L / d b^2]
+  long double t2 = constants.cbb_c - (constants.cb_c * constants.cb_c);
 
-  // d1_mj[2]: dmj_ds
-  d1[0] = tc.cos_psi * tc.cos_delta - tc.sin_psi * tc.sin_delta * df.ddel_ds;
-  d1[1] = tc.cos_psi * tc.sin_delta + tc.sin_psi * tc.cos_delta * df.ddel_ds;
-  d1[2] = -tc.sin_psi;
-  first_order[2] = d1;
+  // E [d^2 L / dk db]
+  long double t3 = constants.ckb_c - (constants.ck_c * constants.cb_c);
 
-  df.d1_mj = first_order;
+  long double det = t1 * t2 - t3 * t3;
+  return log(det);
+}
 
-  // d1_mi[0]: dmi_da
-  // d1_mi[1]: dmi_dn
-  // d1_mi[2]: dmi_ds
-  for (int i=0; i<3; i++) {
-    first_order[i] = computeFirstOrderDifferentialsMinorAxis(i);
+/*!
+ *  \brief Log det of the Fisher matrix of (k,b) (as computeLogFisherScale())
+ *  and its gradient, from the ratios r(n,s) = F(n,s)/c of
+ *  computeLogScaleSeries(). The ratios have the derivatives
+ *  dr/dk = r(n,s+1) + (s/k) r(n,s) - r(n,s) r(0,1)
+ *  dr/db = r(n+1,s) - r(n,s) r(1,0)
+ *  \param r the ratios for n+s <= 2 (n+s <= 3 for the gradient)
+ *  \param gradient (k,b) derivatives of the log det, if not NULL
+ */
+long double Kent::computeLogFisherScale(
+  long double r[MAX_SCALE_ORDER+1][MAX_SCALE_ORDER+1], long double *gradient
+) {
+  // rkk = c_kk/c = r(0,2) + r(0,1)/k
+  long double t1 = r[0][2] + r[0][1]/kappa - r[0][1] * r[0][1];
+  long double t2 = r[2][0] - r[1][0] * r[1][0];
+  long double t3 = r[1][1] - r[0][1] * r[1][0];
+  long double det = t1 * t2 - t3 * t3;
+  if (gradient == NULL) {
+    return log(det);
   }
-  df.d1_mi = first_order;
+
+  long double dr01,dr10,dr02,dr20,dr11,drkk;
+  // d/dk
+  dr01 = r[0][2] + r[0][1]/kappa - r[0][1] * r[0][1];
+  dr10 = r[1][1] - r[1][0] * r[0][1];
+  dr02 = r[0][3] + 2*r[0][2]/kappa - r[0][2] * r[0][1];
+  dr20 = r[2][1] - r[2][0] * r[0][1];
+  dr11 = r[1][2] + r[1][1]/kappa - r[1][1] * r[0][1];
+  drkk = dr02 + dr01/kappa - r[0][1]/(kappa*kappa);
+  gradient[0] = (drkk - 2*r[0][1]*dr01) * t2 + t1 * (dr20 - 2*r[1][0]*dr10)
+                - 2 * t3 * (dr11 - dr01*r[1][0] - r[0][1]*dr10);
+  // d/db
+  dr01 = r[1][1] - r[0][1] * r[1][0];
+  dr10 = r[2][0] - r[1][0] * r[1][0];
+  dr02 = r[1][2] - r[0][2] * r[1][0];
+  dr20 = r[3][0] - r[2][0] * r[1][0];
+  dr11 = r[2][1] - r[1][1] * r[1][0];
+  drkk = dr02 + dr01/kappa;
+  gradient[1] = (drkk - 2*r[0][1]*dr01) * t2 + t1 * (dr20 - 2*r[1][0]*dr10)
+                - 2 * t3 * (dr11 - dr01*r[1][0] - r[0][1]*dr10);
+
+  gradient[0] /= det;
+  gradient[1] /= det;
+  return log(det);
 }
 
-Vector Kent::computeFirstOrderDifferentialsMinorAxis(int i)
+/*!
+ *  \brief Gradient of log det of the Fisher matrix of (k,b) as computed by
+ *  computeLogFisherScale(), with respect to (k,b)
+ */
+Vector Kent::computeGradientLogFisherScale()
 {
-  Vector cross1 = crossProduct(df.d1_mu[i],major_axis);
-  Vector cross2 = crossProduct(mu,df.d1_mj[i]);
-  Vector ans(3,0);
-  for (int i=0; i<3; i++) {
-    ans[i] = cross1[i] + cross2[i];
-  }
-  return ans;
+  long double r[MAX_SCALE_ORDER+1][MAX_SCALE_ORDER+1];
+  long double dlog_fisher[2];
+  computeLogScaleSeries(3,r);
+  computeLogFisherScale(r,dlog_fisher);
+
+  Vector gradient(2,0);
+  gradient[0] = dlog_fisher[0];
+  gradient[1] = dlog_fisher[1];
+  return gradient;
 }
 
-void Kent::computeDeltaDifferentials()
+/*!
+ *  \brief Gradient of computeLogPriorScale() with respect to (k,b)
+ */
+Vector Kent::computeGradientLogPriorScale()
 {
-  long double tmp1,tmp2;
-
-  // d(delta)_d(alpha)
-  tmp1 = tc.sin_d_n * tc.tan_psi * tc.sin_alpha * tc.sin_alpha;
-  df.ddel_da = -1/tmp1;
-
-  // d(delta)_d(psi)
-  tmp1 = tc.sin_d_n * tc.tan_alpha * tc.sin_psi * tc.sin_psi;
-  df.ddel_ds = -1/tmp1;
-
-  // d2(delta)_d(alpha)2
-  tmp1 = tc.tan_psi * tc.sin_alpha * tc.sin_alpha * tc.tan_alpha;
-  tmp2 = 2/tmp1;
-  tmp1 = df.ddel_da * df.ddel_da * tc.cos_d_n;
-  df.d2del_da2 = (tmp2 - tmp1) / tc.sin_d_n;
-
-  // d2(delta)_d(psi)2
-  tmp1 = tc.tan_alpha * tc.sin_psi * tc.sin_psi * tc.tan_psi;
-  tmp2 = 2/tmp1;
-  tmp1 = df.ddel_ds * df.ddel_ds * tc.cos_d_n;
-  df.d2del_ds2 = (tmp2 - tmp1) / tc.sin_d_n;
-
-  // d2(delta)_d(alpha)d(psi)
-  tmp1 = tc.sin_alpha * tc.sin_alpha * tc.sin_psi * tc.sin_psi;
-  tmp2 = 1/tmp1;
-  tmp1 = df.ddel_da * df.ddel_ds * tc.cos_d_n;
-  df.d2del_dads = (tmp2 - tmp1) / tc.sin_d_n;
-}
-
-void Kent::computeSecondOrderDifferentials()
-{
-  std::vector<Vector > second_order(6);
-  Vector d2(3,0);
-
-  // d2_mu[0]: d2mu_da2
-  d2[0] = -tc.sin_alpha * tc.cos_eta;
-  d2[1] = -tc.sin_alpha * tc.sin_eta;
-  d2[2] = -tc.cos_alpha;
-  second_order[0] = d2;
-
-  // d2_mu[1]: d2mu_dn2
-  d2[2] = 0;
-  second_order[1] = d2;
-
-  // d2_mu[2]: d2mu_ds2
-  d2[0] = 0;
-  d2[1] = 0;
-  second_order[2] = d2;
-
-  // d2_mu[3]: d2mu_dadn
-  d2[0] = -tc.cos_alpha * tc.sin_eta;
-  d2[1] = tc.cos_alpha * tc.cos_eta;
-  second_order[3] = d2;
-
-  // d2_mu[4]: d2mu_dads
-  d2[0] = 0;
-  d2[1] = 0;
-  second_order[4] = d2;
-
-  // d2_mu[5]: d2mu_dnds
-  second_order[5] = d2;
-
-  df.d2_mu = second_order;
-
-  // d2_mj[0]: d2mj_da2
-  d2[0] = -tc.sin_psi * (tc.sin_delta * df.d2del_da2 + tc.cos_delta * df.ddel_da * df.ddel_da);
-  d2[1] = tc.sin_psi * (tc.cos_delta * df.d2del_da2 - tc.sin_delta * df.ddel_da * df.ddel_da);
-  d2[2] = 0;
-  second_order[0] = d2;
-
-  // d2_mj[1]: d2mj_dn2
-  d2[0] = -tc.sin_psi * tc.cos_delta;
-  d2[1] = -tc.sin_psi * tc.sin_delta;
-  d2[2] = 0; 
-  second_order[1] = d2;
-
-  // d2_mj[2]: d2mj_ds2
-  d2[0] = -tc.cos_delta * tc.sin_psi - 2 * tc.cos_psi * tc.sin_delta * df.ddel_ds
-          - tc.sin_psi * (tc.sin_delta * df.d2del_ds2 + tc.cos_delta * df.ddel_ds * df.ddel_ds);
-  d2[1] = -tc.sin_delta * tc.sin_psi + 2 * tc.cos_delta * tc.cos_psi * df.ddel_ds
-          + tc.sin_psi * (tc.cos_delta * df.d2del_ds2 - tc.sin_delta * df.ddel_ds * df.ddel_ds);
-  d2[2] = -tc.cos_psi;
-  second_order[2] = d2;
-
-  // d2_mj[3]: d2mj_dadn
-  d2[0] = -df.ddel_da * major_axis[0];
-  d2[1] = -df.ddel_da * major_axis[1];
-  d2[2] = 0;
-  second_order[3] = d2;
-
-  // d2_mj[4]: d2mj_dads
-  d2[0] = -tc.sin_psi * (tc.sin_delta * df.d2del_dads + tc.cos_delta * df.ddel_da * df.ddel_ds)
-          - tc.cos_psi * tc.sin_delta * df.ddel_da;
-  d2[1] = tc.sin_psi * (tc.cos_delta * df.d2del_dads - tc.sin_delta * df.ddel_da * df.ddel_ds)
-          + tc.cos_psi * tc.cos_delta * df.ddel_da;
-  d2[2] = 0; 
-  second_order[4] = d2;
-
-  // d2_mj[5]: d2mj_dnds
-  d2[0] = -tc.cos_psi * tc.sin_delta - tc.sin_psi * tc.cos_delta * df.ddel_ds;
-  d2[1] = tc.cos_psi * tc.cos_delta - tc.sin_psi * tc.sin_delta * df.ddel_ds;
-  d2[2] = 0; 
-  second_order[5] = d2;
-
-  df.d2_mj = second_order;
-
-  // d2_mi[0]: d2mi_da2
-  second_order[0] = computeSecondOrderDifferentialsMinorAxis(0,0,0,0,0,0);
-  // d2_mi[1]: d2mi_dn2
-  second_order[1] = computeSecondOrderDifferentialsMinorAxis(1,1,1,1,1,1);
-  // d2_mi[2]: d2mi_ds2
-  second_order[2] = computeSecondOrderDifferentialsMinorAxis(2,2,2,2,2,2);
-  // d2_mi[3]: d2mi_dadn
-  second_order[3] = computeSecondOrderDifferentialsMinorAxis(3,1,0,3,0,1);
-  // d2_mi[4]: d2mi_dads
-  second_order[4] = computeSecondOrderDifferentialsMinorAxis(4,2,0,4,0,2);
-  // d2_mi[5]: d2mi_dnds
-  second_order[5] = computeSecondOrderDifferentialsMinorAxis(5,2,1,5,1,2);
-
-  df.d2_mi = second_order;
-}
-
-Vector Kent::computeSecondOrderDifferentialsMinorAxis(
-  int i0, int i1, int i2, int i3, int i4, int i5
-) {
-  Vector c1 = crossProduct(df.d2_mu[i0],major_axis);
-  Vector c2 = crossProduct(df.d1_mu[i1],df.d1_mj[i2]);
-  Vector c3 = crossProduct(mu,df.d2_mj[i3]);
-  Vector c4 = crossProduct(df.d1_mu[i4],df.d1_mj[i5]);
-
-  Vector ans(3,0);
-  for (int i=0; i<3; i++) {
-    ans[i] = c1[i] + c2[i] + c3[i] + c4[i];
-  }
-  return ans;
+  Vector gradient(2,0);
+  gradient[0] = 2/kappa - 4*kappa/(1+kappa*kappa);
+  return gradient;
 }
 
-void Kent::computeFisherMatrixAxes()
+/*!
+ *  \brief Index of the second order differential d2/dxi dxj in df.d2_*
+ *  (xi,xj in {alpha,eta,psi})
+ */
+static int secondOrderIndex(int i, int j)
 {
-  df.fisher_axes = ZeroMatrix(3,3);
-  // E[d^2 L / da^2]
-  df.fisher_axes(0,0) = computeExpectationLikelihood(0,0,0);
-  // E[d^2 L / dadn]
-  df.fisher_axes(0,1) = computeExpectationLikelihood(3,0,1);
-  // E[d^2 L / dads]
-  df.fisher_axes(0,2) = computeExpectationLikelihood(4,0,2);
-  // E[d^2 L / dn^2]
-  df.fisher_axes(1,1) = computeExpectationLikelihood(1,1,1);
-  // E[d^2 L / dnds]
-  df.fisher_axes(1,2) = computeExpectationLikelihood(5,1,2);
-  // E[d^2 L / ds^2]
-  df.fisher_axes(2,2) = computeExpectationLikelihood(2,2,2);
-  df.fisher_axes(1,0) = df.fisher_axes(0,1);
-  df.fisher_axes(2,0) = df.fisher_axes(0,2);
-  df.fisher_axes(2,1) = df.fisher_axes(1,2);
-  //cout << "FisherAxes: " << df.fisher_axes << endl;
+  if (i == j) return i;
+  if (i > j) std::swap(i,j);
+  if (i == 0) return j + 2;   // (0,1): 3, (0,2): 4
+  return 5;                   // (1,2)
 }
 
-long double Kent::computeExpectationLikelihood(int i1, int i2, int i3)
+/*!
+ *  \brief Gradient of the negative log likelihood with respect to
+ *  (alpha,eta,psi,kappa,beta). delta is tied to the other angles by 
+ *  cos(delta-eta) = -cot(alpha) cot(psi), so the object should have been
+ *  constructed from the angles.
+ *  \param sample_mean a reference to a Vector (\sum x)
+ *  \param S a reference to a Matrix (\sum x x')
+ *  \param N the sample size
+ */
+Vector Kent::computeGradientNegativeLogLikelihood(const Vector &sample_mean, const Matrix &S, long double N)
 {
-  long double t1 = computeDotProduct(constants.kappa_E_x,df.d2_mu[i1]);
+  Vector gradient;
+  Matrix hessian;
+  computeDerivativesNegativeLogLikelihood(sample_mean,S,N,gradient,hessian,0);
+  return gradient;
+}
 
-  long double t2 = prod_xMy(major_axis,constants.beta_E_xx,df.d2_mj[i1]);
-  t2 += prod_xMy(df.d1_mj[i2],constants.beta_E_xx,df.d1_mj[i3]);
-  t2 *= 2;
+/*!
+ *  \brief Hessian of the negative log likelihood with respect to
+ *  (alpha,eta,psi,kappa,beta)
+ */
+Matrix Kent::computeHessianNegativeLogLikelihood(const Vector &sample_mean, const Matrix &S, long double N)
+{
+  Vector gradient;
+  Matrix hessian;
+  computeDerivativesNegativeLogLikelihood(sample_mean,S,N,gradient,hessian,1);
+  return hessian;
+}
 
-  long double t3 = prod_xMy(minor_axis,constants.beta_E_xx,df.d2_mi[i1]);
-  t3 += prod_xMy(df.d1_mi[i2],constants.beta_E_xx,df.d1_mi[i3]);
-  t3 *= 2;
+/*!
+ *  \brief Gradient and (optionally) the Hessian of 
+ *  N log c(k,b) - k (m0' x) - b (mj' xx' mj - mi' xx' mi)
+ *  using the first and second order differentials of the axes.
+ *  The k-k entry uses the exact c_kk = F(0,2) + F(0,1)/k.
+ */
+void Kent::computeDerivativesNegativeLogLikelihood(
+  const Vector &sample_mean, const Matrix &S, long double N,
+  Vector &gradient, Matrix &hessian, int compute_hessian
+) {
+  computeDifferentials(compute_hessian ? 2 : 1);
+  if (scale_computed != SET) {
+    computeScaleConstants();
+  }
+  long double r01 = constants.ck_c;
+  long double r10 = constants.cb_c;
 
-  return -t1-t2+t3;
-}
+  long double mj = prod_xMy(major_axis,S,major_axis);
+  long double mi = prod_xMy(minor_axis,S,minor_axis);
 
-long double Kent::computeLogFisherScale()
-{
-  // E [d^2 L / d k^2]
-  long double t1 = constants.ckk_c - (constants.ck_c * constants.ck_c);
+  // derivatives of (m0' x) and (mj' xx' mj - mi' xx' mi) w.r.t. the angles
+  long double d_c1[3],d_c2[3];
+  for (int i=0; i<3; i++) {
+    d_c1[i] = dot3(&sample_mean[0],df.d1_mu[i]);
+    d_c2[i] = 2 * (prod_xMy3(&major_axis[0],&S.data()[0],df.d1_mj[i]) 
+                   - prod_xMy3(&minor_axis[0],&S.data()[0],df.d1_mi[i]));
+  }
 
-  // E [d^2 L / d b^2]
-  long double t2 = constants.cbb_c - (constants.cb_c * constants.cb_c);
+  gradient = Vector(5,0);
+  for (int i=0; i<3; i++) {
+    gradient[i] = -kappa * d_c1[i] - beta * d_c2[i];
+  }
+  gradient[3] = N * r01 - computeDotProduct(sample_mean,mu);
+  gradient[4] = N * r10 - (mj - mi);
+  if (!compute_hessian) return;
 
-  // E [d^2 L / dk db]
-  long double t3 = constants.ckb_c - (constants.ck_c * constants.cb_c);
+  long double rkk = constants.ckk_c;
+  long double r11 = constants.ckb_c;
+  long double r20 = constants.cbb_c;
 
-  long double det = t1 * t2 - t3;
-  return log(det);
+  hessian = ZeroMatrix(5,5);
+  for (int i=0; i<3; i++) {
+    for (int j=i; j<3; j++) {
+      int q = secondOrderIndex(i,j);
+      long double t1 = dot3(&sample_mean[0],df.d2_mu[q]);
+      long double t2 = prod_xMy3(&major_axis[0],&S.data()[0],df.d2_mj[q]) 
+                       + prod_xMy3(df.d1_mj[i],&S.data()[0],df.d1_mj[j]);
+      long double t3 = prod_xMy3(&minor_axis[0],&S.data()[0],df.d2_mi[q]) 
+                       + prod_xMy3(df.d1_mi[i],&S.data()[0],df.d1_mi[j]);
+      hessian(i,j) = -kappa * t1 - 2 * beta * (t2 - t3);
+      hessian(j,i) = hessian(i,j);
+    }
+    hessian(i,3) = hessian(3,i) = -d_c1[i];
+    hessian(i,4) = hessian(4,i) = -d_c2[i];
+  }
+  hessian(3,3) = N * (rkk - r01 * r01);
+  hessian(3,4) = hessian(4,3) = N * (r11 - r01 * r10);
+  hessian(4,4) = N * (r20 - r10 * r10);
 }
 
 void Kent::computeAllEstimators(std::vector<Vector> &data)
@@ -679,7 +1017,7 @@ void Kent::computeAllEstimators(std::vector<Vector> &data)
   computeAllEstimators(sample_mean,S,data.size());
 }
 
-void Kent::computeAllEstimators(Vector &sample_mean, Matrix &S, int N)
+void Kent::computeAllEstimators(Vector &sample_mean, Matrix &S, long double N)
 {
   string type = "MOMENT";
   struct Estimates moment_est = computeMomentEstimates(sample_mean,S,N);
@@ -725,8 +1063,23 @@ struct Estimates Kent::computeMomentEstimates(std::vector<Vector> &data)
  *  (similar to used in Kent (1982) paper)
  *  (sample_mean1 and S1 are \sum_x and \sum_ x x')
  */
-struct Estimates Kent::computeMomentEstimates(Vector &sample_mean1, Matrix &S1, int N)
+struct Estimates Kent::computeMomentEstimates(Vector &sample_mean1, Matrix &S1, long double N)
 {
+  struct Estimates estimates = computeAsymptoticMomentEstimates(sample_mean1,S1,N);
+  Optimize opt("MOMENT");
+  opt.initialize(N,estimates.mean,estimates.major_axis,estimates.minor_axis,
+                 estimates.kappa,estimates.beta);
+  opt.computeEstimates(sample_mean1,S1,estimates);
+  return estimates;
+}
+
+/*!
+ *  Closed form part of the moment estimation: the axes and the large
+ *  concentration approximations of kappa and beta (Kent (1982))
+ */
+struct Estimates Kent::computeAsymptoticMomentEstimates(
+  Vector &sample_mean1, Matrix &S1, long double N
+) {
   Vector sample_mean = sample_mean1;
   Matrix S = S1; 
   for (int i=0; i<3; i++) {
@@ -805,10 +1158,6 @@ struct Estimates Kent::computeMomentEstimates(Vector &sample_mean1, Matrix &S1,
   //cout << "r1: " << r1 << endl;
   //cout << "r2: " << r2 << endl;
 
-  Optimize opt("MOMENT");
-  opt.initialize(N,estimates.mean,estimates.major_axis,estimates.minor_axis,
-                 estimates.kappa,estimates.beta);
-  opt.computeEstimates(sample_mean1,S1,estimates);
   return estimates;
 }
 
@@ -822,7 +1171,7 @@ struct Estimates Kent::computeMLEstimates(std::vector<Vector> &data, string type
   return computeMLEstimates(sample_mean,S,data.size(),type);
 }
 
-struct Estimates Kent::computeMLEstimates(Vector &sample_mean, Matrix &S, int N, string type)
+struct Estimates Kent::computeMLEstimates(Vector &sample_mean, Matrix &S, long double N, string type)
 {
   struct Estimates estimates = computeMomentEstimates(sample_mean,S,N);
   Optimize opt(type);
@@ -842,7 +1191,7 @@ struct Estimates Kent::computeMMLEstimates(std::vector<Vector> &data)
   return computeMMLEstimates(sample_mean,S,data.size());
 }
 
-struct Estimates Kent::computeMMLEstimates(Vector &sample_mean, Matrix &S, int N)
+struct Estimates Kent::computeMMLEstimates(Vector &sample_mean, Matrix &S, long double N)
 {
   struct Estimates estimates = computeMomentEstimates(sample_mean,S,N);
   Optimize opt("MML");
@@ -3,6 +3,31 @@
 
 #include "Header.h"
 #include "Support.h"
+#include "KentMath.h"
+
+#define MAX_SCALE_ORDER 3   // largest n+s of the series F(n,s) summed together
+
+/*!
+ *  The message length (in nats) of a sample stated with a Kent 
+ *  distribution, term by term:
+ *  I = -log h(axes) - log h(k,b) + 0.5 (log det F(axes) + log det F(k,b) 
+ *      + 5 log N) + L + lattice + precision
+ *  where F are the Fisher matrices for one observation and L is the 
+ *  negative log likelihood. Only N, L and precision depend on the data.
+ */
+struct MessageLength
+{
+  long double log_prior_axes,log_prior_scale;
+  long double log_fisher_axes,log_fisher_scale;
+  long double log_fisher_sample_size;   // 5 log N
+  long double negative_log_likelihood;
+  long double lattice;                  // (5/2) log(kd) + 5/2
+  long double precision;                // -2 N log(AOM)
+  long double N;
+  long double first_part;               // the prior and Fisher terms
+  long double second_part;              // likelihood and precision
+  long double total;                    // first_part + second_part + lattice
+};
 
 class Kent  // FB5
 {
@@ -16,36 +41,30 @@ class Kent  // FB5
     long double kappa,beta; // gamma = 0
 
     struct Constants {
+      // scale part: depends on kappa, beta only
       long double log_c,log_cb,log_ck,log_ckk,log_ckb,log_cbb;
       long double ck_c,ckk_c,cb_c,cbb_c,ckb_c;
+      // orientation part: depends on the axes only
+      Matrix R,Rt;  // R: standard -> current orientation
+      // expectations: depend on both
       Vector E_x,kappa_E_x;
       Matrix E_xx,beta_E_xx;
-      Matrix R,Rt;  // R: standard -> current orientation
     } constants;
 
-    struct TrignometryConstants {
-      long double cos_alpha,sin_alpha,tan_alpha;
-      long double cos_eta,sin_eta;
-      long double cos_psi,sin_psi,tan_psi;
-      long double cos_delta,sin_delta;
-      long double d_n,cos_d_n,sin_d_n;
-    } tc;
-
-    //  d1_mu (3 X 3): <dmu_da> <dmu_dn> <dmu_ds>
-    //  d2_mu (6 X 3): [0] <d2mu_da2> 
-    //                 [1] <d2mu_dn2> 
-    //                 [2] <d2mu_ds2> 
-    //                 [3] <d2mu_dadn> 
-    //                 [4] <d2mu_dads> 
-    //                 [5] <d2mu_dnds>
-    struct Differentials {
-      std::vector<Vector > d1_mu,d1_mj,d1_mi;
-      std::vector<Vector > d2_mu,d2_mj,d2_mi;
-      long double ddel_da,ddel_ds,d2del_da2,d2del_ds2,d2del_dads;
+    TrignometryConstants<long double> tc;
+
+    // differentials of the axes with respect to the angles (KentMath.h)
+    struct Differentials : public AxesDifferentials<long double> {
       Matrix fisher_axes;
     } df;
 
-    int computed;
+    int computed;               // E_x, E_xx
+
+    int scale_computed;         // log c and the ratios (kappa,beta)
+
+    int orientation_computed;   // R, Rt (axes)
+
+    int differentials_computed; // order of the differentials of the axes (angles)
 
   public:
     Kent();
@@ -58,6 +77,15 @@ class Kent  // FB5
  
     Kent operator=(const Kent &);
 
+    void setParameters(long double, long double, long double, long double, 
+                       long double, long double);
+
+    void setAxes(const Vector &, const Vector &, long double, long double);
+
+    void setScale(long double, long double);
+
+    void setScale(Kent &);
+
     std::vector<Vector> generate(int);
 
     std::vector<Vector> generateCanonical(int);
@@ -66,6 +94,8 @@ class Kent  // FB5
 
     struct Constants getConstants();
 
+    static long normalizerEvaluations();
+
     long double computeLogNormalizationConstant();
 
     long double log_dc_dk();
@@ -82,31 +112,46 @@ class Kent  // FB5
 
     long double log_d2c_db2();
 
-    void computeConstants();
+    long double computeLogDerivativeSeries(int, int);
 
-    void computeExpectation();
+    long double computeLogScaleSeries(int, long double [MAX_SCALE_ORDER+1][MAX_SCALE_ORDER+1]);
 
-    long double computeLogFisherAxes();
+    Vector computeGradientLogNormalizationConstant();
 
-    long double computeExpectationLikelihood(int, int, int);
+    void computeConstants();
 
-    void computeFirstOrderDifferentials();
+    void computeScaleConstants();
 
-    Vector computeFirstOrderDifferentialsMinorAxis(int);
+    void computeOrientationConstants();
 
-    void computeDeltaDifferentials();
+    void computeExpectation();
 
-    void computeSecondOrderDifferentials();
+    long double computeLogFisherAxes();
 
-    Vector computeSecondOrderDifferentialsMinorAxis(int, int, int, int, int, int);
+    void computeDifferentials(int);
 
     void computeFisherMatrixAxes();
 
     long double computeLogFisherScale();
 
+    long double computeLogFisherScale(long double [MAX_SCALE_ORDER+1][MAX_SCALE_ORDER+1], long double *);
+
+    Vector computeGradientLogFisherScale();
+
     long double computeNegativeLogLikelihood(std::vector<Vector> &);
 
-    long double computeNegativeLogLikelihood(Vector &, Matrix &, int);
+    long double computeNegativeLogLikelihood(const Vector &, const Matrix &, long double);
+
+    long double log_density(const Vector &);
+
+    void log_density(const double *, long, double *);
+
+    Vector computeGradientNegativeLogLikelihood(const Vector &, const Matrix &, long double);
+
+    Matrix computeHessianNegativeLogLikelihood(const Vector &, const Matrix &, long double);
+
+    void computeDerivativesNegativeLogLikelihood(const Vector &, const Matrix &, long double,
+                                                 Vector &, Matrix &, int);
 
     long double computeLogPriorProbability();
 
@@ -114,25 +159,33 @@ class Kent  // FB5
 
     long double computeLogPriorScale();
 
+    Vector computeGradientLogPriorScale();
+
     long double computeLogFisherInformation();
 
-    long double computeLogFisherInformation(int);
+    long double computeLogFisherInformation(long double);
+
+    struct MessageLength computeMessageLength(const Vector &, const Matrix &, long double);
+
+    void updateMessageLength(struct MessageLength &, const Vector &, const Matrix &, long double);
 
     void computeAllEstimators(std::vector<Vector> &);
 
-    void computeAllEstimators(Vector &, Matrix &, int);
+    void computeAllEstimators(Vector &, Matrix &, long double);
 
     struct Estimates computeMomentEstimates(std::vector<Vector> &);
 
-    struct Estimates computeMomentEstimates(Vector &, Matrix &, int);
+    struct Estimates computeMomentEstimates(Vector &, Matrix &, long double);
+
+    struct Estimates computeAsymptoticMomentEstimates(Vector &, Matrix &, long double);
 
     struct Estimates computeMLEstimates(std::vector<Vector> &, string);
 
-    struct Estimates computeMLEstimates(Vector &, Matrix &, int, string);
+    struct Estimates computeMLEstimates(Vector &, Matrix &, long double, string);
 
     struct Estimates computeMMLEstimates(std::vector<Vector> &);
 
-    struct Estimates computeMMLEstimates(Vector &, Matrix &, int);
+    struct Estimates computeMMLEstimates(Vector &, Matrix &, long double);
 
     Vector Mean();
 
@@ -0,0 +1,397 @@
+#ifndef KENT_MATH_H
+#define KENT_MATH_H
+
+#include "Header.h"
+
+/*!
+ *  The parts of the Kent model that are plain arithmetic on the
+ *  parameters, written once for any scalar type T: long double for Kent
+ *  and Dual (Dual.h) for exact derivatives (DualKent). 3D vectors are
+ *  arrays of 3 and 3 X 3 matrices are row-major arrays of 9.
+ */
+
+template <typename T>
+struct TrignometryConstants
+{
+  T cos_alpha,sin_alpha,tan_alpha;
+  T cos_eta,sin_eta;
+  T cos_psi,sin_psi,tan_psi;
+  T cos_delta,sin_delta;
+  T d_n,cos_d_n,sin_d_n;
+};
+
+//  d1_mu (3 X 3): <dmu_da> <dmu_dn> <dmu_ds>
+//  d2_mu (6 X 3): [0] <d2mu_da2>
+//                 [1] <d2mu_dn2>
+//                 [2] <d2mu_ds2>
+//                 [3] <d2mu_dadn>
+//                 [4] <d2mu_dads>
+//                 [5] <d2mu_dnds>
+//  (likewise for mj and mi); fixed size so that they live in the object
+template <typename T>
+struct AxesDifferentials
+{
+  T d1_mu[3][3],d1_mj[3][3],d1_mi[3][3];
+  T d2_mu[6][3],d2_mj[6][3],d2_mi[6][3];
+  T ddel_da,ddel_ds,d2del_da2,d2del_ds2,d2del_dads;
+};
+
+// the constants of the normalization constant c(k,b) used by the model
+template <typename T>
+struct ScaleConstants
+{
+  T log_c;
+  T ck_c,cb_c,ckk_c,ckb_c,cbb_c;  // derivatives of c over c
+};
+
+/*!
+ *  \brief x' y
+ */
+template <typename T, typename U>
+inline T dot3(const T *x, const U *y)
+{
+  return x[0] * y[0] + x[1] * y[1] + x[2] * y[2];
+}
+
+/*!
+ *  \brief x' M y
+ */
+template <typename T, typename U>
+inline T prod_xMy3(const T *x, const U *M, const T *y)
+{
+  return x[0] * (M[0] * y[0] + M[1] * y[1] + M[2] * y[2])
+         + x[1] * (M[3] * y[0] + M[4] * y[1] + M[5] * y[2])
+         + x[2] * (M[6] * y[0] + M[7] * y[1] + M[8] * y[2]);
+}
+
+/*!
+ *  \brief ans = v1 X v2
+ */
+template <typename T>
+inline void crossProduct3(const T *v1, const T *v2, T *ans)
+{
+  ans[0] = v1[1] * v2[2] - v1[2] * v2[1];
+  ans[1] = v1[2] * v2[0] - v1[0] * v2[2];
+  ans[2] = v1[0] * v2[1] - v1[1] * v2[0];
+}
+
+/*!
+ *  \brief ans += v1 X v2
+ */
+template <typename T>
+inline void addCrossProduct3(const T *v1, const T *v2, T *ans)
+{
+  ans[0] += v1[1] * v2[2] - v1[2] * v2[1];
+  ans[1] += v1[2] * v2[0] - v1[0] * v2[2];
+  ans[2] += v1[0] * v2[1] - v1[1] * v2[0];
+}
+
+template <typename T>
+inline T determinant3(const T M[3][3])
+{
+  return M[0][0] * (M[1][1] * M[2][2] - M[1][2] * M[2][1])
+         - M[0][1] * (M[1][0] * M[2][2] - M[1][2] * M[2][0])
+         + M[0][2] * (M[1][0] * M[2][1] - M[1][1] * M[2][0]);
+}
+
+/*!
+ *  \brief The rotation matrix R(w) = exp([w]_x) (Rodrigues), as
+ *  computeRotationMatrix() of Support
+ */
+template <typename T>
+void computeRotationMatrix3(const T *w, T R[3][3])
+{
+  T tsq = w[0]*w[0] + w[1]*w[1] + w[2]*w[2];
+  T a,b;
+  if (tsq < 1e-8) {
+    a = 1 - tsq / 6;
+    b = 0.5 - tsq / 24;
+  } else {
+    T t = sqrt(tsq);
+    a = sin(t) / t;
+    b = (1 - cos(t)) / tsq;
+  }
+  for (int i=0; i<3; i++) {
+    for (int j=0; j<3; j++) {
+      R[i][j] = b * w[i] * w[j];
+    }
+    R[i][i] += 1 - b * tsq;
+  }
+  R[0][1] -= a * w[2]; R[1][0] += a * w[2];
+  R[0][2] += a * w[1]; R[2][0] -= a * w[1];
+  R[1][2] -= a * w[0]; R[2][1] += a * w[0];
+}
+
+template <typename T>
+void computeTrignometryConstants(
+  const T &alpha, const T &eta, const T &psi, const T &delta,
+  TrignometryConstants<T> &tc
+) {
+  tc.cos_alpha = cos(alpha);
+  tc.sin_alpha = sin(alpha);
+  tc.tan_alpha = tan(alpha);
+
+  tc.cos_eta = cos(eta);
+  tc.sin_eta = sin(eta);
+
+  tc.cos_delta = cos(delta);
+  tc.sin_delta = sin(delta);
+
+  tc.d_n = delta - eta;
+  tc.cos_d_n = cos(tc.d_n);
+  tc.sin_d_n = sin(tc.d_n);
+
+  tc.cos_psi = cos(psi);
+  tc.sin_psi = sin(psi);
+  tc.tan_psi = tan(psi);
+}
+
+/*!
+ *  \brief The mean mu (alpha,eta), the major axis mj (psi,delta) and the
+ *  minor axis mi = mu X mj
+ */
+template <typename T>
+void computeAxes(const TrignometryConstants<T> &tc, T *mu, T *mj, T *mi)
+{
+  mu[0] = tc.sin_alpha * tc.cos_eta;
+  mu[1] = tc.sin_alpha * tc.sin_eta;
+  mu[2] = tc.cos_alpha;
+  mj[0] = tc.sin_psi * tc.cos_delta;
+  mj[1] = tc.sin_psi * tc.sin_delta;
+  mj[2] = tc.cos_psi;
+  crossProduct3(mu,mj,mi);
+}
+
+/*!
+ *  \brief Brings the differentials of the axes with respect to the angles
+ *  (alpha,eta,psi; delta is tied to them by cos(delta-eta) =
+ *  -cot(alpha) cot(psi)) from the given order up to the requested one
+ *  (1 or 2). The differentials of delta, mu, mj and mi = mu X mj are
+ *  computed in one pass.
+ *  \return the order of the differentials now in df
+ */
+template <typename T>
+int computeAxesDifferentials(
+  const TrignometryConstants<T> &tc, const T *mu, const T *mj,
+  int computed, int order, AxesDifferentials<T> &df
+) {
+  if (computed < 1) {
+    T tmp1,tmp2;
+    // d(delta)_d(alpha), d(delta)_d(psi)
+    tmp1 = tc.sin_d_n * tc.tan_psi * tc.sin_alpha * tc.sin_alpha;
+    df.ddel_da = -1/tmp1;
+    tmp1 = tc.sin_d_n * tc.tan_alpha * tc.sin_psi * tc.sin_psi;
+    df.ddel_ds = -1/tmp1;
+
+    // d2(delta)_d(alpha)2
+    tmp1 = tc.tan_psi * tc.sin_alpha * tc.sin_alpha * tc.tan_alpha;
+    tmp2 = 2/tmp1;
+    tmp1 = df.ddel_da * df.ddel_da * tc.cos_d_n;
+    df.d2del_da2 = (tmp2 - tmp1) / tc.sin_d_n;
+
+    // d2(delta)_d(psi)2
+    tmp1 = tc.tan_alpha * tc.sin_psi * tc.sin_psi * tc.tan_psi;
+    tmp2 = 2/tmp1;
+    tmp1 = df.ddel_ds * df.ddel_ds * tc.cos_d_n;
+    df.d2del_ds2 = (tmp2 - tmp1) / tc.sin_d_n;
+
+    // d2(delta)_d(alpha)d(psi)
+    tmp1 = tc.sin_alpha * tc.sin_alpha * tc.sin_psi * tc.sin_psi;
+    tmp2 = 1/tmp1;
+    tmp1 = df.ddel_da * df.ddel_ds * tc.cos_d_n;
+    df.d2del_dads = (tmp2 - tmp1) / tc.sin_d_n;
+
+    // d1_mu: dmu_da, dmu_dn, dmu_ds = 0
+    T (*d1)[3] = df.d1_mu;
+    d1[0][0] = tc.cos_alpha * tc.cos_eta;
+    d1[0][1] = tc.cos_alpha * tc.sin_eta;
+    d1[0][2] = -tc.sin_alpha;
+    d1[1][0] = -tc.sin_alpha * tc.sin_eta;
+    d1[1][1] = tc.sin_alpha * tc.cos_eta;
+    d1[1][2] = 0;
+    d1[2][0] = d1[2][1] = d1[2][2] = 0;
+
+    // d1_mj: dmj_da, dmj_dn, dmj_ds
+    d1 = df.d1_mj;
+    d1[0][0] = -tc.sin_psi * tc.sin_delta * df.ddel_da;
+    d1[0][1] = tc.sin_psi * tc.cos_delta * df.ddel_da;
+    d1[0][2] = 0;
+    d1[1][0] = -tc.sin_psi * tc.sin_delta;
+    d1[1][1] = tc.sin_psi * tc.cos_delta;
+    d1[1][2] = 0;
+    d1[2][0] = tc.cos_psi * tc.cos_delta - tc.sin_psi * tc.sin_delta * df.ddel_ds;
+    d1[2][1] = tc.cos_psi * tc.sin_delta + tc.sin_psi * tc.cos_delta * df.ddel_ds;
+    d1[2][2] = -tc.sin_psi;
+
+    // d1_mi[i] = d1_mu[i] X mj + mu X d1_mj[i]
+    for (int i=0; i<3; i++) {
+      crossProduct3(df.d1_mu[i],mj,df.d1_mi[i]);
+      addCrossProduct3(mu,df.d1_mj[i],df.d1_mi[i]);
+    }
+    computed = 1;
+  }
+  if (order < 2 || computed >= 2) {
+    return computed;
+  }
+
+  // d2_mu: [0] da2, [1] dn2, [2] ds2 = 0, [3] dadn, [4] dads = 0, [5] dnds = 0
+  T (*d2)[3] = df.d2_mu;
+  d2[0][0] = -tc.sin_alpha * tc.cos_eta;
+  d2[0][1] = -tc.sin_alpha * tc.sin_eta;
+  d2[0][2] = -tc.cos_alpha;
+  d2[1][0] = d2[0][0];
+  d2[1][1] = d2[0][1];
+  d2[1][2] = 0;
+  d2[3][0] = -tc.cos_alpha * tc.sin_eta;
+  d2[3][1] = tc.cos_alpha * tc.cos_eta;
+  d2[3][2] = 0;
+  for (int j=0; j<3; j++) {
+    d2[2][j] = d2[4][j] = d2[5][j] = 0;
+  }
+
+  // d2_mj
+  d2 = df.d2_mj;
+  d2[0][0] = -tc.sin_psi * (tc.sin_delta * df.d2del_da2 + tc.cos_delta * df.ddel_da * df.ddel_da);
+  d2[0][1] = tc.sin_psi * (tc.cos_delta * df.d2del_da2 - tc.sin_delta * df.ddel_da * df.ddel_da);
+  d2[0][2] = 0;
+
+  d2[1][0] = -tc.sin_psi * tc.cos_delta;
+  d2[1][1] = -tc.sin_psi * tc.sin_delta;
+  d2[1][2] = 0;
+
+  d2[2][0] = -tc.cos_delta * tc.sin_psi - 2 * tc.cos_psi * tc.sin_delta * df.ddel_ds
+             - tc.sin_psi * (tc.sin_delta * df.d2del_ds2 + tc.cos_delta * df.ddel_ds * df.ddel_ds);
+  d2[2][1] = -tc.sin_delta * tc.sin_psi + 2 * tc.cos_delta * tc.cos_psi * df.ddel_ds
+             + tc.sin_psi * (tc.cos_delta * df.d2del_ds2 - tc.sin_delta * df.ddel_ds * df.ddel_ds);
+  d2[2][2] = -tc.cos_psi;
+
+  d2[3][0] = -df.ddel_da * mj[0];
+  d2[3][1] = -df.ddel_da * mj[1];
+  d2[3][2] = 0;
+
+  d2[4][0] = -tc.sin_psi * (tc.sin_delta * df.d2del_dads + tc.cos_delta * df.ddel_da * df.ddel_ds)
+             - tc.cos_psi * tc.sin_delta * df.ddel_da;
+  d2[4][1] = tc.sin_psi * (tc.cos_delta * df.d2del_dads - tc.sin_delta * df.ddel_da * df.ddel_ds)
+             + tc.cos_psi * tc.cos_delta * df.ddel_da;
+  d2[4][2] = 0;
+
+  d2[5][0] = -tc.cos_psi * tc.sin_delta - tc.sin_psi * tc.cos_delta * df.ddel_ds;
+  d2[5][1] = tc.cos_psi * tc.cos_delta - tc.sin_psi * tc.sin_delta * df.ddel_ds;
+  d2[5][2] = 0;
+
+  // d2_mi[q] = d2_mu[q] X mj + d1_mu[i] X d1_mj[j] + mu X d2_mj[q]
+  //            + d1_mu[j] X d1_mj[i], for q = d2/didj
+  static const int pairs[6][2] = {{0,0},{1,1},{2,2},{0,1},{0,2},{1,2}};
+  for (int q=0; q<6; q++) {
+    int i = pairs[q][0], j = pairs[q][1];
+    crossProduct3(df.d2_mu[q],mj,df.d2_mi[q]);
+    addCrossProduct3(df.d1_mu[i],df.d1_mj[j],df.d2_mi[q]);
+    addCrossProduct3(mu,df.d2_mj[q],df.d2_mi[q]);
+    addCrossProduct3(df.d1_mu[j],df.d1_mj[i],df.d2_mi[q]);
+  }
+  return 2;
+}
+
+/*!
+ *  \brief E[x] = (c_k/c) mu and E[x x'] = R diag(lambda) R' with
+ *  R = [mj | mi | mu] (the rotation from the standard frame) and lambda
+ *  the second moments in the standard frame.
+ *  \return false if a second moment is not positive
+ */
+template <typename T>
+bool computeMoments(
+  const T *mu, const T *mj, const T *mi, const ScaleConstants<T> &sc,
+  T *E_x, T *E_xx
+) {
+  for (int i=0; i<3; i++) {
+    E_x[i] = mu[i] * sc.ck_c;
+  }
+  T lambda[3];
+  lambda[0] = 0.5 * (1 - sc.ckk_c + sc.cb_c);  // lambda_1
+  lambda[1] = 0.5 * (1 - sc.ckk_c - sc.cb_c);  // lambda_2
+  lambda[2] = sc.ckk_c;                        // lambda_3
+  if (!(lambda[0] > 0 && lambda[1] > 0 && lambda[2] > 0)) {
+    return false;
+  }
+  const T *R[3] = {mj,mi,mu};  // columns
+  for (int i=0; i<3; i++) {
+    for (int j=0; j<3; j++) {
+      E_xx[3*i+j] = R[0][i] * lambda[0] * R[0][j] + R[1][i] * lambda[1] * R[1][j]
+                    + R[2][i] * lambda[2] * R[2][j];
+    }
+  }
+  return true;
+}
+
+/*!
+ *  \brief E[d^2 L / dxi dxj] of one observation, with xi,xj the angles
+ *  given by the indices of the differentials: i1 of the second order
+ *  one, i2 and i3 of the first order ones.
+ */
+template <typename T>
+T computeExpectationLikelihood(
+  const T *kappa_E_x, const T *beta_E_xx, const T *mj, const T *mi,
+  const AxesDifferentials<T> &df, int i1, int i2, int i3
+) {
+  T t1 = dot3(kappa_E_x,df.d2_mu[i1]);
+
+  T t2 = prod_xMy3(mj,beta_E_xx,df.d2_mj[i1]);
+  t2 += prod_xMy3(df.d1_mj[i2],beta_E_xx,df.d1_mj[i3]);
+  t2 *= 2;
+
+  T t3 = prod_xMy3(mi,beta_E_xx,df.d2_mi[i1]);
+  t3 += prod_xMy3(df.d1_mi[i2],beta_E_xx,df.d1_mi[i3]);
+  t3 *= 2;
+
+  return -t1-t2+t3;
+}
+
+/*!
+ *  \brief The Fisher matrix of the angles (alpha,eta,psi) for one
+ *  observation; df must hold the second order differentials.
+ */
+template <typename T>
+void computeFisherMatrixAxes(
+  const T *kappa_E_x, const T *beta_E_xx, const T *mj, const T *mi,
+  const AxesDifferentials<T> &df, T F[3][3]
+) {
+  // E[d^2 L / da^2], E[d^2 L / dadn], E[d^2 L / dads]
+  F[0][0] = computeExpectationLikelihood(kappa_E_x,beta_E_xx,mj,mi,df,0,0,0);
+  F[0][1] = computeExpectationLikelihood(kappa_E_x,beta_E_xx,mj,mi,df,3,0,1);
+  F[0][2] = computeExpectationLikelihood(kappa_E_x,beta_E_xx,mj,mi,df,4,0,2);
+  // E[d^2 L / dn^2], E[d^2 L / dnds]
+  F[1][1] = computeExpectationLikelihood(kappa_E_x,beta_E_xx,mj,mi,df,1,1,1);
+  F[1][2] = computeExpectationLikelihood(kappa_E_x,beta_E_xx,mj,mi,df,5,1,2);
+  // E[d^2 L / ds^2]
+  F[2][2] = computeExpectationLikelihood(kappa_E_x,beta_E_xx,mj,mi,df,2,2,2);
+  F[1][0] = F[0][1];
+  F[2][0] = F[0][2];
+  F[2][1] = F[1][2];
+}
+
+/*!
+ *  \brief log det of the Fisher matrix of (k,b) for one observation
+ */
+template <typename T>
+T computeLogFisherScale(const ScaleConstants<T> &sc)
+{
+  T t1 = sc.ckk_c - sc.ck_c * sc.ck_c;  // E [d^2 L / d k^2]
+  T t2 = sc.cbb_c - sc.cb_c * sc.cb_c;  // E [d^2 L / d b^2]
+  T t3 = sc.ckb_c - sc.ck_c * sc.cb_c;  // E [d^2 L / dk db]
+  return log(t1 * t2 - t3 * t3);
+}
+
+template <typename T>
+T computeLogPriorAxes(const T &alpha)
+{
+  return log(4) - 4*log(PI) + log(sin(alpha));
+}
+
+template <typename T>
+T computeLogPriorScale(const T &kappa)
+{
+  return 2 * log(kappa) - 2 * log(1+kappa*kappa);
+}
+
+#endif
+
@@ -0,0 +1,530 @@
+#include "KentMixture.h"
+#include "Statistics.h"
+
+/*!
+ *  Constructor: one thread per OpenMP thread
+ *  \param K the number of components
+ *  \param type estimation of the components: MOMENT, MLE (MLE_NEWTON),
+ *  MLE_UNCONSTRAINED, MML_SCALE or MML
+ */
+KentMixture::KentMixture(int K, string type) :
+                         K(K), type(type), num_threads(omp_get_max_threads()),
+                         data(NULL), num_points(0), cache(NULL), log_likelihood(0),
+                         iterations(0)
+{
+  assert(K >= 1);
+  if (type.compare("MLE") == 0) {
+    this->type = "MLE_NEWTON";
+  }
+}
+
+KentMixture::KentMixture(int K, string type, int num_threads) : KentMixture(K,type)
+{
+  this->num_threads = (num_threads < 1) ? 1 : num_threads;
+}
+
+int KentMixture::numThreads()
+{
+  return num_threads;
+}
+
+Vector KentMixture::getWeights()
+{
+  return weights;
+}
+
+std::vector<struct Estimates> KentMixture::getEstimates()
+{
+  return estimates;
+}
+
+std::vector<Kent> KentMixture::getComponents()
+{
+  return components;
+}
+
+/*!
+ *  \brief The weighted statistics of the components at the last E-step
+ */
+std::vector<struct SufficientStatistics> KentMixture::getStatistics()
+{
+  return statistics;
+}
+
+/*!
+ *  \brief Shares a cache of fits with other mixtures: the M-step fits are
+ *  warm started from the cached fit of the closest statistics, if any, and
+ *  cached. The cache must outlive the fits.
+ */
+void KentMixture::setCache(WarmStartCache *cache)
+{
+  this->cache = cache;
+}
+
+/*!
+ *  \brief The log likelihood of the data at the last E-step
+ */
+long double KentMixture::logLikelihood()
+{
+  return log_likelihood;
+}
+
+int KentMixture::numIterations()
+{
+  return iterations;
+}
+
+/*!
+ *  \brief Fits the mixture to a sample of 3D unit vectors.
+ *  \param sample a reference to a std::vector<Vector>
+ *  \return the number of EM iterations
+ */
+int KentMixture::estimate(std::vector<Vector> &sample)
+{
+  num_points = sample.size();
+  points.resize(3 * num_points);
+  for (long i=0; i<num_points; i++) {
+    for (int j=0; j<3; j++) {
+      points[3*i+j] = sample[i][j];
+    }
+  }
+  data = &points[0];
+  return run();
+}
+
+/*!
+ *  \brief Fits the mixture to 3D unit vectors stored contiguously
+ *  (row-major, as accumulateStatistics()).
+ */
+int KentMixture::estimate(const long double *x, long rows)
+{
+  num_points = rows;
+  points.assign(x,x + 3 * rows);
+  data = &points[0];
+  return run();
+}
+
+/*!
+ *  \brief Fits the mixture to 3D unit vectors of the caller (row-major),
+ *  which are not copied and must outlive the fit.
+ */
+int KentMixture::estimate(const double *x, long rows)
+{
+  points.clear();
+  data = x;
+  num_points = rows;
+  return run();
+}
+
+/*!
+ *  \brief Runs EM from the given components instead of initialize(), on
+ *  3D unit vectors of the caller (not copied).
+ *  \param x the points (row-major)
+ *  \param rows the number of points
+ *  \param initial_weights the K weights to start from
+ *  \param initial the K components to start from
+ *  \return the number of EM iterations
+ */
+int KentMixture::estimate(
+  const double *x, long rows, Vector &initial_weights, std::vector<struct Estimates> &initial
+) {
+  assert(initial_weights.size() == K && initial.size() == K);
+  points.clear();
+  data = x;
+  num_points = rows;
+  if (num_points < K) {
+    cout << "Error: " << num_points << " points for " << K << " components ...\n";
+    return 0;
+  }
+  weights = initial_weights;
+  estimates = initial;
+  setComponents();
+  return iterate();
+}
+
+/*!
+ *  \brief Sets the components (as from a previous fit)
+ */
+void KentMixture::setParameters(Vector &weights, std::vector<struct Estimates> &estimates)
+{
+  assert(weights.size() == K && estimates.size() == K);
+  this->weights = weights;
+  this->estimates = estimates;
+  setComponents();
+}
+
+/*!
+ *  \brief One E-step over a batch of 3D unit vectors of the caller
+ *  (row-major, not copied), which replace the points of the mixture: the
+ *  weighted statistics of each component under the current components.
+ *  \param x the points
+ *  \param rows the number of points
+ *  \param stats set to the statistics of the batch
+ *  \return the log likelihood of the batch
+ */
+long double KentMixture::accumulate(
+  const double *x, long rows, std::vector<struct SufficientStatistics> &stats
+) {
+  data = x;
+  num_points = rows;
+  computeTerms();
+  return expectation(stats);
+}
+
+/*!
+ *  \brief One M-step from the given statistics (their weights need not sum
+ *  to the number of points, as for decayed statistics).
+ */
+void KentMixture::update(std::vector<struct SufficientStatistics> &stats)
+{
+  assert(stats.size() == K);
+  maximization(stats);
+}
+
+/*!
+ *  \brief EM from initialize() until the log likelihood changes by less
+ *  than MIXTURE_TOLERANCE per point.
+ */
+int KentMixture::run()
+{
+  if (num_points < K) {
+    cout << "Error: " << num_points << " points for " << K << " components ...\n";
+    return 0;
+  }
+  initialize();
+  return iterate();
+}
+
+/*!
+ *  \brief The EM iterations from the current components; the statistics
+ *  of the last E-step are kept.
+ */
+int KentMixture::iterate()
+{
+  long double previous = -std::numeric_limits<long double>::infinity();
+  for (iterations=1; ; iterations++) {
+    computeTerms();
+    log_likelihood = expectation(statistics);
+    if (fabs(log_likelihood - previous) < MIXTURE_TOLERANCE * num_points ||
+        iterations == MIXTURE_MAX_ITERATIONS) {
+      break;
+    }
+    previous = log_likelihood;
+    maximization(statistics);
+  }
+  return iterations;
+}
+
+/*!
+ *  \brief log w_k f_k(x) = log w_k - log c_k + k_k mu_k' x
+ *  + b_k (mj_k' x)^2 - b_k (mi_k' x)^2 = \sum_j terms[j][k] f_j(x) with
+ *  f(x) = (1, x1, x2, x3, x1^2, x2^2, x3^2, x1 x2, x1 x3, x2 x3).
+ */
+void KentMixture::computeTerms()
+{
+  terms.assign(NUM_MIXTURE_TERMS * K,0);
+  for (int k=0; k<K; k++) {
+    struct Estimates &e = estimates[k];
+    long double log_c = components[k].computeLogNormalizationConstant();
+    terms[k] = log(weights[k]) - log_c;
+    long double Q[3][3];
+    for (int i=0; i<3; i++) {
+      terms[(1+i)*K+k] = e.kappa * e.mean[i];
+      for (int j=0; j<3; j++) {
+        Q[i][j] = e.beta * (e.major_axis[i] * e.major_axis[j]
+                            - e.minor_axis[i] * e.minor_axis[j]);
+      }
+    }
+    terms[4*K+k] = Q[0][0];
+    terms[5*K+k] = Q[1][1];
+    terms[6*K+k] = Q[2][2];
+    terms[7*K+k] = 2 * Q[0][1];
+    terms[8*K+k] = 2 * Q[0][2];
+    terms[9*K+k] = 2 * Q[1][2];
+  }
+}
+
+/*!
+ *  \brief The E-step: for each point, the log densities under all the
+ *  components, their log-sum-exp and the responsibilities, which weight
+ *  the point in the statistics of each component. Each thread sums its
+ *  blocks in double precision (the layout of terms) and folds them into
+ *  the statistics once.
+ *  \param stats the weighted statistics of each component
+ *  \return the log likelihood
+ */
+long double KentMixture::expectation(std::vector<struct SufficientStatistics> &stats)
+{
+  stats.resize(K);
+  for (int k=0; k<K; k++) {
+    initializeStatistics(stats[k],3);
+  }
+  long double total = 0;
+  long num_blocks = (num_points + MIXTURE_BLOCK_SIZE - 1) / MIXTURE_BLOCK_SIZE;
+  const double *t = &terms[0];
+
+  #pragma omp parallel num_threads(num_threads)
+  {
+    std::vector<double> log_p(K),sums(NUM_MIXTURE_TERMS * K,0);
+    double *p = &log_p[0];
+    long double local = 0;
+    #pragma omp for schedule(static)
+    for (long b=0; b<num_blocks; b++) {
+      long first = b * MIXTURE_BLOCK_SIZE;
+      long last = std::min(first + MIXTURE_BLOCK_SIZE,num_points);
+      double block_log_likelihood = 0;
+      for (long i=first; i<last; i++) {
+        const double *x = &data[3*i];
+        double f[NUM_MIXTURE_TERMS] = {
+          1, x[0], x[1], x[2], x[0]*x[0], x[1]*x[1], x[2]*x[2],
+          x[0]*x[1], x[0]*x[2], x[1]*x[2]
+        };
+        #pragma omp simd
+        for (int k=0; k<K; k++) {
+          p[k] = t[k] + t[K+k] * f[1] + t[2*K+k] * f[2] + t[3*K+k] * f[3]
+                 + t[4*K+k] * f[4] + t[5*K+k] * f[5] + t[6*K+k] * f[6]
+                 + t[7*K+k] * f[7] + t[8*K+k] * f[8] + t[9*K+k] * f[9];
+        }
+        double max = p[0];
+        for (int k=1; k<K; k++) {
+          max = (p[k] > max) ? p[k] : max;
+        }
+        double sum = 0;
+        for (int k=0; k<K; k++) {
+          p[k] = exp(p[k] - max);
+          sum += p[k];
+        }
+        block_log_likelihood += max + log(sum);
+        for (int j=0; j<NUM_MIXTURE_TERMS; j++) {
+          double fj = f[j] / sum;
+          double *s = &sums[j*K];
+          #pragma omp simd
+          for (int k=0; k<K; k++) {
+            s[k] += p[k] * fj;
+          }
+        }
+      }
+      local += block_log_likelihood;
+    }
+    #pragma omp critical
+    {
+      total += local;
+      for (int k=0; k<K; k++) {
+        struct SufficientStatistics &s = stats[k];
+        s.N += sums[k];
+        for (int i=0; i<3; i++) {
+          s.sum_x[i] += sums[(1+i)*K+k];
+          s.sum_xx(i,i) += sums[(4+i)*K+k];
+        }
+        s.sum_xx(0,1) += sums[7*K+k]; s.sum_xx(1,0) += sums[7*K+k];
+        s.sum_xx(0,2) += sums[8*K+k]; s.sum_xx(2,0) += sums[8*K+k];
+        s.sum_xx(1,2) += sums[9*K+k]; s.sum_xx(2,1) += sums[9*K+k];
+      }
+    }
+  }
+  return total;
+}
+
+bool KentMixture::isValid(struct Estimates &e)
+{
+  if (!(std::isfinite(e.kappa) && std::isfinite(e.beta) && e.kappa > 0 && e.beta >= 0)) {
+    return false;
+  }
+  for (int i=0; i<3; i++) {
+    if (!(std::isfinite(e.mean[i]) && std::isfinite(e.major_axis[i]) &&
+          std::isfinite(e.minor_axis[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*!
+ *  \brief A component fitted to its statistics (from scratch, or from the
+ *  closest cached fit)
+ */
+struct Estimates KentMixture::fit(struct SufficientStatistics &stats)
+{
+  if (cache == NULL) {
+    return computeEstimates(stats,type);
+  }
+  return cache->estimate(stats,type);
+}
+
+/*!
+ *  \brief A component refitted to its statistics, warm started from its
+ *  previous estimates or, if another mixture cached the fit of nearly the
+ *  same statistics, from that fit.
+ */
+struct Estimates KentMixture::fit(struct SufficientStatistics &stats, struct Estimates &previous)
+{
+  if (cache == NULL) {
+    return computeEstimates(stats,type,previous);
+  }
+  struct Estimates cached,fitted;
+  if (cache->lookup(stats,type,cached)) {
+    fitted = computeEstimates(stats,type,cached);
+  } else {
+    fitted = computeEstimates(stats,type,previous);
+  }
+  cache->insert(stats,type,fitted);
+  return fitted;
+}
+
+/*!
+ *  \brief The Kent distributions of the current estimates
+ */
+void KentMixture::setComponents()
+{
+  components.resize(K);
+  for (int k=0; k<K; k++) {
+    struct Estimates &e = estimates[k];
+    components[k] = Kent(e.mean,e.major_axis,e.minor_axis,e.kappa,e.beta);
+  }
+}
+
+/*!
+ *  \brief The M-step: the weights and each component refitted to its
+ *  weighted statistics, starting from its current estimates. A component
+ *  left with less than MIXTURE_MIN_SIZE points (or whose fit fails) keeps
+ *  its estimates.
+ */
+void KentMixture::maximization(std::vector<struct SufficientStatistics> &stats)
+{
+  #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+  for (int k=0; k<K; k++) {
+    if (stats[k].N < MIXTURE_MIN_SIZE) continue;
+    struct Estimates fitted = fit(stats[k],estimates[k]);
+    if (isValid(fitted)) {
+      estimates[k] = fitted;
+    }
+  }
+  long double total = 0;
+  for (int k=0; k<K; k++) {
+    total += stats[k].N;
+  }
+  for (int k=0; k<K; k++) {
+    weights[k] = stats[k].N / total;
+  }
+  setComponents();
+}
+
+/*!
+ *  \brief Seeds the components at K points picked as in k-means++ (each
+ *  next seed with probability proportional to 1 - max cos to the seeds so
+ *  far) and refines the seeds by MIXTURE_SEED_ITERATIONS rounds of
+ *  spherical k-means: the points are assigned to the seeds (an E-step
+ *  with vMF components of concentration MIXTURE_SEED_KAPPA) and the seeds
+ *  move to the mean directions of their points. Each component is then
+ *  fitted to its points. A component whose fit fails starts at the fit to all the data.
+ */
+void KentMixture::initialize()
+{
+  std::vector<long> seeds(1,rand() % num_points);
+  std::vector<double> distance(num_points,2);
+  for (int s=1; s<K; s++) {
+    const double *y = &data[3*seeds[s-1]];
+    double total = 0;
+    #pragma omp parallel for num_threads(num_threads) reduction(+:total)
+    for (long i=0; i<num_points; i++) {
+      const double *x = &data[3*i];
+      double d = 1 - (x[0]*y[0] + x[1]*y[1] + x[2]*y[2]);
+      if (d < distance[i]) distance[i] = d;
+      total += distance[i];
+    }
+    double u = total * rand() / (double) RAND_MAX;
+    long next = 0;
+    for (; next<num_points-1; next++) {
+      u -= distance[next];
+      if (u <= 0) break;
+    }
+    seeds.push_back(next);
+  }
+
+  std::vector<Vector> centers(K,Vector(3,0));
+  for (int k=0; k<K; k++) {
+    for (int i=0; i<3; i++) {
+      centers[k][i] = data[3*seeds[k]+i];
+    }
+  }
+  std::vector<struct SufficientStatistics> stats;
+  for (int iter=0; iter<MIXTURE_SEED_ITERATIONS; iter++) {
+    terms.assign(NUM_MIXTURE_TERMS * K,0);
+    for (int k=0; k<K; k++) {
+      for (int i=0; i<3; i++) {
+        terms[(1+i)*K+k] = MIXTURE_SEED_KAPPA * centers[k][i];
+      }
+    }
+    expectation(stats);
+    // the centers move to the (weighted) mean directions
+    for (int k=0; k<K; k++) {
+      if (norm(stats[k].sum_x) > 0) {
+        normalize(stats[k].sum_x,centers[k]);
+      }
+    }
+  }
+
+  struct SufficientStatistics all;
+  initializeStatistics(all,3);
+  for (int k=0; k<K; k++) {
+    all.N += stats[k].N;
+    for (int i=0; i<3; i++) {
+      all.sum_x[i] += stats[k].sum_x[i];
+    }
+    all.sum_xx += stats[k].sum_xx;
+  }
+  struct Estimates fallback = computeEstimates(all,"MOMENT");
+
+  weights = Vector(K,0);
+  estimates.assign(K,fallback);
+  #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+  for (int k=0; k<K; k++) {
+    if (stats[k].N < MIXTURE_MIN_SIZE) continue;
+    struct Estimates fitted = fit(stats[k]);
+    if (isValid(fitted)) {
+      estimates[k] = fitted;
+    }
+  }
+  for (int k=0; k<K; k++) {
+    weights[k] = stats[k].N / num_points;
+    if (weights[k] == 0) weights[k] = 1.0 / num_points;
+  }
+  setComponents();
+}
+
+/*!
+ *  \brief The message length (in nats) of the data stated with the fitted
+ *  mixture (as Wallace's and Kasarapu and Allison's mixtures of
+ *  multivariate distributions):
+ *  I = log K + I(w) + \sum_k I(Theta_k) - log K! + I(D|Theta), with
+ *  I(w) = ((K-1)/2) (log N + 1) - (1/2) \sum_k log w_k - log (K-1)!,
+ *  I(Theta_k) the first part and lattice terms of the Kent message length
+ *  of component k given its weighted statistics (Kent::computeMessageLength())
+ *  and I(D|Theta) = -log likelihood - 2 N log(AOM). log K! counts the
+ *  orderings of the components as one message.
+ *  \return the message length (infinity if a component has no finite one)
+ */
+long double KentMixture::computeMessageLength()
+{
+  if (statistics.size() != K) {
+    return std::numeric_limits<long double>::infinity();
+  }
+  long double N = num_points;
+  long double ans = log((long double) K) - lgamma<long double>(K+1);
+  ans += 0.5 * (K-1) * (log(N) + 1) - lgamma<long double>(K);
+  for (int k=0; k<K; k++) {
+    ans -= 0.5 * log(weights[k]);
+    Kent component;  // with its angles, which the prior and Fisher terms need
+    component.setAxes(estimates[k].mean,estimates[k].major_axis,
+                      estimates[k].kappa,estimates[k].beta);
+    struct SufficientStatistics &s = statistics[k];
+    struct MessageLength ml = component.computeMessageLength(s.sum_x,s.sum_xx,s.N);
+    ans += ml.first_part + ml.lattice;
+  }
+  ans += -log_likelihood - 2 * N * log(AOM);
+  if (!std::isfinite(ans)) {
+    return std::numeric_limits<long double>::infinity();
+  }
+  return ans;
+}
+
@@ -0,0 +1,129 @@
+#ifndef KENT_MIXTURE_H
+#define KENT_MIXTURE_H
+
+#include "Header.h"
+#include "Support.h"
+#include "Kent.h"
+#include "WarmStartCache.h"
+
+#define MIXTURE_MAX_ITERATIONS 500
+#define MIXTURE_TOLERANCE 1e-7      // change of the log likelihood per point
+#define MIXTURE_MIN_SIZE 5          // smallest (weighted) size refitted
+#define MIXTURE_BLOCK_SIZE 1024     // points per E-step task
+#define MIXTURE_SEED_KAPPA 100      // concentration of the initial assignment
+#define MIXTURE_SEED_ITERATIONS 5   // spherical k-means rounds before the first fit
+
+// the terms of log w_k f_k(x), one array per term (see computeTerms())
+#define NUM_MIXTURE_TERMS 10
+
+/*!
+ *  A mixture of Kent distributions fitted by EM.
+ *  E-step: the log densities of a point under all the components are
+ *  a quadratic form in x, evaluated together (SIMD over the components,
+ *  in double precision) from NUM_MIXTURE_TERMS arrays of coefficients;
+ *  the responsibilities (log-sum-exp) are folded straight into per
+ *  thread weighted sufficient statistics, so the N x K responsibilities
+ *  are never stored. The points are split into blocks over the OpenMP
+ *  threads.
+ *  M-step: each component is refitted to its weighted statistics
+ *  (\sum r x, \sum r x x', \sum r) by the estimator of the given type,
+ *  starting from its previous estimates (computeEstimates()); the
+ *  components are refitted concurrently.
+ *  The fit can start from given components instead of initialize(), on
+ *  points owned by the caller, and its M-step fits can be warm started
+ *  from a WarmStartCache shared with other mixtures of the same data (as
+ *  the candidates of a MixtureSearch). The E- and M-steps are also
+ *  exposed one at a time (accumulate(), update()), for a stream of
+ *  batches (OnlineKentMixture).
+ */
+class KentMixture
+{
+  private:
+    int K;
+
+    string type;
+
+    int num_threads;
+
+    std::vector<double> points;   // row-major, 3 per point
+
+    const double *data;           // the points (owned or the caller's)
+
+    long num_points;
+
+    Vector weights;
+
+    std::vector<struct Estimates> estimates;
+
+    std::vector<Kent> components;
+
+    std::vector<double> terms;    // NUM_MIXTURE_TERMS arrays of K
+
+    std::vector<struct SufficientStatistics> statistics;  // of the last E-step
+
+    WarmStartCache *cache;        // shared warm starts (optional)
+
+    long double log_likelihood;
+
+    int iterations;
+
+    int run();
+
+    int iterate();
+
+    void computeTerms();
+
+    void initialize();
+
+    long double expectation(std::vector<struct SufficientStatistics> &);
+
+    void maximization(std::vector<struct SufficientStatistics> &);
+
+    bool isValid(struct Estimates &);
+
+    struct Estimates fit(struct SufficientStatistics &);
+
+    struct Estimates fit(struct SufficientStatistics &, struct Estimates &);
+
+    void setComponents();
+
+  public:
+    KentMixture(int, string);
+
+    KentMixture(int, string, int);
+
+    int estimate(std::vector<Vector> &);
+
+    int estimate(const long double *, long);
+
+    int estimate(const double *, long);
+
+    int estimate(const double *, long, Vector &, std::vector<struct Estimates> &);
+
+    void setCache(WarmStartCache *);
+
+    void setParameters(Vector &, std::vector<struct Estimates> &);
+
+    long double accumulate(const double *, long, std::vector<struct SufficientStatistics> &);
+
+    void update(std::vector<struct SufficientStatistics> &);
+
+    Vector getWeights();
+
+    std::vector<struct Estimates> getEstimates();
+
+    std::vector<Kent> getComponents();
+
+    std::vector<struct SufficientStatistics> getStatistics();
+
+    long double computeMessageLength();
+
+    long double logLikelihood();
+
+    int numIterations();
+
+    int numThreads();
+};
+
+#endif
+
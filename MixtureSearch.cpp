@@ -0,0 +1,271 @@
+#include "MixtureSearch.h"
+#include "Statistics.h"
+
+/*!
+ *  Constructor
+ *  \param type estimation of the components (as KentMixture)
+ *  \param num_threads the number of candidates fitted at a time
+ */
+MixtureSearch::MixtureSearch(string type, int num_threads) :
+                             type(type), max_components(MIXTURE_SEARCH_MAX_COMPONENTS),
+                             pool(num_threads), cache(MIXTURE_SEARCH_CACHE_SIZE),
+                             num_points(0), num_candidates(0)
+{
+  if (type.compare("MLE") == 0) {
+    this->type = "MLE_NEWTON";  // as KentMixture, so the cache keys agree
+  }
+}
+
+void MixtureSearch::setMaxComponents(int max_components)
+{
+  this->max_components = (max_components < 1) ? 1 : max_components;
+}
+
+int MixtureSearch::numThreads()
+{
+  return pool.size();
+}
+
+/*!
+ *  \brief The best mixture after each round (the first one component)
+ */
+std::vector<struct MixtureCandidate> MixtureSearch::getHistory()
+{
+  return history;
+}
+
+/*!
+ *  \brief The number of mixtures fitted by the last search
+ */
+long MixtureSearch::numCandidates()
+{
+  return num_candidates;
+}
+
+/*!
+ *  \brief The number of M-step fits warm started from a cached fit (made
+ *  by any candidate)
+ */
+long MixtureSearch::numCacheHits()
+{
+  return cache.numHits();
+}
+
+/*!
+ *  \brief Searches for the mixture of a sample of 3D unit vectors with the
+ *  shortest message length.
+ *  \param sample a reference to a std::vector<Vector>
+ *  \return the best mixture
+ */
+struct MixtureCandidate MixtureSearch::search(std::vector<Vector> &sample)
+{
+  num_points = sample.size();
+  points.resize(3 * num_points);
+  for (long i=0; i<num_points; i++) {
+    for (int j=0; j<3; j++) {
+      points[3*i+j] = sample[i][j];
+    }
+  }
+  return search();
+}
+
+/*!
+ *  \brief Searches for the mixture of 3D unit vectors stored contiguously
+ *  (row-major, as accumulateStatistics()).
+ */
+struct MixtureCandidate MixtureSearch::search(const long double *x, long rows)
+{
+  num_points = rows;
+  points.assign(x,x + 3 * rows);
+  return search();
+}
+
+struct MixtureCandidate MixtureSearch::search()
+{
+  history.clear();
+  cache.clear();
+  num_candidates = 0;
+
+  struct MixtureCandidate best;
+  best.move = "initial";
+  best.K = 1;
+  evaluate(best);
+  num_candidates++;
+  history.push_back(best);
+  if (num_points < 1) {
+    cout << "Error: no points ...\n";
+    return best;
+  }
+
+  while (1) {
+    std::vector<struct MixtureCandidate> candidates = propose(best);
+    if (candidates.size() == 0) break;
+    evaluate(candidates);
+    int shortest = 0;
+    for (int i=1; i<candidates.size(); i++) {
+      if (candidates[i].message_length < candidates[shortest].message_length) {
+        shortest = i;
+      }
+    }
+    if (!(candidates[shortest].message_length < best.message_length)) break;
+    best = candidates[shortest];
+    history.push_back(best);
+  }
+  return best;
+}
+
+/*!
+ *  \brief Fits a candidate by EM (single threaded) from its components, or
+ *  from KentMixture::initialize() if it has none, and states its message
+ *  length.
+ */
+void MixtureSearch::evaluate(struct MixtureCandidate &candidate)
+{
+  KentMixture mixture(candidate.K,type,1);
+  mixture.setCache(&cache);
+  if (candidate.estimates.size() == 0) {
+    candidate.iterations = mixture.estimate(&points[0],num_points);
+  } else {
+    candidate.iterations = mixture.estimate(
+      &points[0],num_points,candidate.weights,candidate.estimates
+    );
+  }
+  if (candidate.iterations == 0) {
+    candidate.message_length = std::numeric_limits<long double>::infinity();
+    return;
+  }
+  candidate.weights = mixture.getWeights();
+  candidate.estimates = mixture.getEstimates();
+  candidate.statistics = mixture.getStatistics();
+  candidate.log_likelihood = mixture.logLikelihood();
+  candidate.message_length = mixture.computeMessageLength();
+}
+
+/*!
+ *  \brief Fits the candidates concurrently, one task each.
+ */
+void MixtureSearch::evaluate(std::vector<struct MixtureCandidate> &candidates)
+{
+  for (int i=0; i<candidates.size(); i++) {
+    struct MixtureCandidate *candidate = &candidates[i];
+    pool.submit([this,candidate] {
+      evaluate(*candidate);
+    });
+  }
+  pool.wait();
+  num_candidates += candidates.size();
+}
+
+/*!
+ *  \brief The neighbours of a mixture: its splits, its merges of each
+ *  component with the nearest (largest cosine of the means) other one and
+ *  a fresh fit with one more component.
+ */
+std::vector<struct MixtureCandidate> MixtureSearch::propose(struct MixtureCandidate &parent)
+{
+  std::vector<struct MixtureCandidate> candidates;
+  struct MixtureCandidate child;
+  if (parent.K < max_components) {
+    for (int j=0; j<parent.K; j++) {
+      if (split(parent,j,child)) {
+        candidates.push_back(child);
+      }
+    }
+    child = MixtureCandidate();
+    child.move = "fresh";
+    child.K = parent.K + 1;
+    candidates.push_back(child);
+  }
+  std::vector<std::pair<int,int> > pairs;
+  for (int j=0; j<parent.K && parent.K>1; j++) {
+    int nearest = -1;
+    long double largest = -2;
+    for (int l=0; l<parent.K; l++) {
+      if (l == j) continue;
+      long double cos_angle = computeDotProduct(parent.estimates[j].mean,parent.estimates[l].mean);
+      if (cos_angle > largest) {
+        largest = cos_angle;
+        nearest = l;
+      }
+    }
+    std::pair<int,int> pair(std::min(j,nearest),std::max(j,nearest));
+    if (std::find(pairs.begin(),pairs.end(),pair) != pairs.end()) continue;
+    pairs.push_back(pair);
+    if (merge(parent,pair.first,pair.second,child)) {
+      candidates.push_back(child);
+    }
+  }
+  return candidates;
+}
+
+/*!
+ *  \brief Replaces a component by two with half its weight, their means
+ *  rotated away from its mean (in the plane of its mean and major axis) by
+ *  the angular spread of its points along the major axis.
+ *  \return false if the component has too few points to split
+ */
+bool MixtureSearch::split(struct MixtureCandidate &parent, int j, struct MixtureCandidate &child)
+{
+  struct SufficientStatistics &s = parent.statistics[j];
+  if (s.N < 2 * MIXTURE_MIN_SIZE) return false;
+  struct Estimates &e = parent.estimates[j];
+  Vector S_mj(3,0);
+  for (int i=0; i<3; i++) {
+    for (int l=0; l<3; l++) {
+      S_mj[i] += s.sum_xx(i,l) * e.major_axis[l];
+    }
+  }
+  long double spread = computeDotProduct(e.major_axis,S_mj) / s.N;
+  if (spread > 1) spread = 1;
+  long double angle = asin(sqrt(spread));
+  if (!(angle > MIXTURE_SEARCH_MIN_SPREAD)) angle = MIXTURE_SEARCH_MIN_SPREAD;
+
+  child = parent;
+  child.move = "split " + std::to_string(j);
+  child.K = parent.K + 1;
+  child.weights[j] = parent.weights[j] / 2;
+  child.weights.push_back(parent.weights[j] / 2);
+  child.estimates.push_back(e);
+  int halves[2] = {j,parent.K};
+  for (int h=0; h<2; h++) {
+    long double t = (h == 0) ? angle : -angle;
+    struct Estimates &half = child.estimates[halves[h]];
+    for (int i=0; i<3; i++) {
+      half.mean[i] = cos(t) * e.mean[i] + sin(t) * e.major_axis[i];
+      half.major_axis[i] = -sin(t) * e.mean[i] + cos(t) * e.major_axis[i];
+    }
+  }
+  child.statistics.clear();
+  return true;
+}
+
+/*!
+ *  \brief Replaces two components by one fitted to their summed statistics.
+ *  \return false if that fit fails
+ */
+bool MixtureSearch::merge(
+  struct MixtureCandidate &parent, int j, int l, struct MixtureCandidate &child
+) {
+  struct SufficientStatistics merged;
+  initializeStatistics(merged,3);
+  merged.N = parent.statistics[j].N + parent.statistics[l].N;
+  for (int i=0; i<3; i++) {
+    merged.sum_x[i] = parent.statistics[j].sum_x[i] + parent.statistics[l].sum_x[i];
+  }
+  merged.sum_xx = parent.statistics[j].sum_xx + parent.statistics[l].sum_xx;
+  struct Estimates fitted = cache.estimate(merged,type);
+  if (!(std::isfinite(fitted.kappa) && std::isfinite(fitted.beta) && fitted.kappa > 0)) {
+    return false;
+  }
+
+  child = parent;
+  child.move = "merge " + std::to_string(j) + " " + std::to_string(l);
+  child.K = parent.K - 1;
+  child.weights[j] = parent.weights[j] + parent.weights[l];
+  child.estimates[j] = fitted;
+  child.weights.erase(child.weights.begin() + l);
+  child.estimates.erase(child.estimates.begin() + l);
+  child.statistics.clear();
+  return true;
+}
+
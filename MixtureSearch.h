@@ -0,0 +1,95 @@
+#ifndef MIXTURE_SEARCH_H
+#define MIXTURE_SEARCH_H
+
+#include "Header.h"
+#include "Support.h"
+#include "KentMixture.h"
+#include "ThreadPool.h"
+#include "WarmStartCache.h"
+
+#include <algorithm>
+
+#define MIXTURE_SEARCH_MAX_COMPONENTS 20
+#define MIXTURE_SEARCH_CACHE_SIZE 256   // fits shared by the candidates
+#define MIXTURE_SEARCH_MIN_SPREAD 0.01  // smallest angle of a split (radians)
+
+/*!
+ *  A mixture considered by the search and its fit
+ */
+struct MixtureCandidate
+{
+  string move;              // how it was made from the previous best
+  int K;
+  Vector weights;           // empty: fitted from initialize()
+  std::vector<struct Estimates> estimates;
+  std::vector<struct SufficientStatistics> statistics;  // of the components
+  long double log_likelihood;
+  long double message_length;
+  int iterations;
+};
+
+/*!
+ *  Chooses the number of components of a Kent mixture by minimum message
+ *  length (KentMixture::computeMessageLength()). Starting from one
+ *  component, each round proposes the neighbours of the best mixture so
+ *  far: each component split in two along its major axis, each component
+ *  merged with its nearest neighbour, and a fresh fit with one more
+ *  component. The candidates are fitted by EM concurrently, one per task
+ *  of a thread pool (each EM single threaded), on one shared copy of the
+ *  points. A merge starts from the fit to the summed statistics of the
+ *  two components, and all the M-step fits go through one WarmStartCache,
+ *  so a component left unchanged by a move is warm started from the fit
+ *  another candidate made of nearly the same statistics. The search stops
+ *  when no candidate shortens the message.
+ */
+class MixtureSearch
+{
+  private:
+    string type;
+
+    int max_components;
+
+    ThreadPool pool;
+
+    WarmStartCache cache;
+
+    std::vector<double> points;   // row-major, 3 per point
+
+    long num_points;
+
+    std::vector<struct MixtureCandidate> history;
+
+    long num_candidates;
+
+    struct MixtureCandidate search();
+
+    void evaluate(struct MixtureCandidate &);
+
+    void evaluate(std::vector<struct MixtureCandidate> &);
+
+    std::vector<struct MixtureCandidate> propose(struct MixtureCandidate &);
+
+    bool split(struct MixtureCandidate &, int, struct MixtureCandidate &);
+
+    bool merge(struct MixtureCandidate &, int, int, struct MixtureCandidate &);
+
+  public:
+    MixtureSearch(string, int);
+
+    void setMaxComponents(int);
+
+    struct MixtureCandidate search(std::vector<Vector> &);
+
+    struct MixtureCandidate search(const long double *, long);
+
+    std::vector<struct MixtureCandidate> getHistory();
+
+    long numCandidates();
+
+    long numCacheHits();
+
+    int numThreads();
+};
+
+#endif
+
@@ -0,0 +1,135 @@
+#include "OnlineEstimator.h"
+#include "Statistics.h"
+
+/*!
+ *  Constructor
+ *  \param type estimation: MOMENT, MLE_UNCONSTRAINED, MML_SCALE or MML
+ *  \param mode EXPONENTIAL_DECAY or SLIDING_WINDOW
+ *  \param parameter the decay factor in (0,1] or the window length
+ */
+OnlineEstimator::OnlineEstimator(string type, int mode, long double parameter) :
+                                 type(type), mode(mode), decay(1), window(0)
+{
+  if (mode == EXPONENTIAL_DECAY) {
+    assert(parameter > 0 && parameter <= 1);
+    decay = parameter;
+  } else {
+    assert(parameter >= 1);
+    window = (int) parameter;
+  }
+  reset();
+}
+
+void OnlineEstimator::reset()
+{
+  initializeStatistics(stats,3);
+  ring.clear();
+  head = 0;
+  seen = 0;
+  fitted = false;
+}
+
+/*!
+ *  \brief stats += weight * (x, x x', 1)
+ */
+void OnlineEstimator::addToStatistics(Vector &x, long double weight)
+{
+  for (int i=0; i<3; i++) {
+    stats.sum_x[i] += weight * x[i];
+    for (int j=0; j<3; j++) {
+      stats.sum_xx(i,j) += weight * x[i] * x[j];
+    }
+  }
+  stats.N += weight;
+}
+
+/*!
+ *  \brief Adds a new point: the decayed statistics are scaled down
+ *  before the point is added; the windowed statistics drop the point
+ *  that falls out of the window.
+ */
+void OnlineEstimator::add(Vector &x)
+{
+  if (mode == EXPONENTIAL_DECAY) {
+    if (decay < 1) {
+      for (int i=0; i<3; i++) {
+        stats.sum_x[i] *= decay;
+        for (int j=0; j<3; j++) {
+          stats.sum_xx(i,j) *= decay;
+        }
+      }
+      stats.N *= decay;
+    }
+    addToStatistics(x,1);
+  } else {
+    if (ring.size() < window) {
+      ring.push_back(x);
+    } else {
+      addToStatistics(ring[head],-1);
+      ring[head] = x;
+      head = (head + 1) % window;
+    }
+    addToStatistics(x,1);
+    if (head == 0 && ring.size() == window) {
+      // resum once per window so that the subtractions do not drift
+      initializeStatistics(stats,3);
+      for (int i=0; i<window; i++) {
+        addToStatistics(ring[i],1);
+      }
+    }
+  }
+  seen++;
+}
+
+void OnlineEstimator::add(std::vector<Vector> &sample)
+{
+  for (int i=0; i<sample.size(); i++) {
+    add(sample[i]);
+  }
+}
+
+/*!
+ *  \brief Refits the distribution to the current statistics. The first
+ *  fit runs the full estimator; later fits are warm started from the 
+ *  previous estimates (see computeEstimates()).
+ *  \return the estimates
+ */
+struct Estimates OnlineEstimator::refit()
+{
+  if (!fitted) {
+    estimates = computeEstimates(stats,type);
+    fitted = true;
+    return estimates;
+  }
+
+  struct Estimates previous = estimates;
+  estimates = computeEstimates(stats,type,previous);
+  return estimates;
+}
+
+struct Estimates OnlineEstimator::getEstimates()
+{
+  return estimates;
+}
+
+struct SufficientStatistics OnlineEstimator::getStatistics()
+{
+  return stats;
+}
+
+/*!
+ *  \brief The (decayed) number of points the statistics represent
+ */
+long double OnlineEstimator::effectiveSampleSize()
+{
+  return stats.N;
+}
+
+/*!
+ *  \brief The number of points added since the last reset
+ */
+long OnlineEstimator::numberOfPoints()
+{
+  return seen;
+}
+
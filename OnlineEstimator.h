@@ -0,0 +1,63 @@
+#ifndef ONLINE_ESTIMATOR_H
+#define ONLINE_ESTIMATOR_H
+
+#include "Header.h"
+#include "Support.h"
+
+#define EXPONENTIAL_DECAY 1
+#define SLIDING_WINDOW 2
+
+/*!
+ *  Keeps the sufficient statistics of a stream of unit vectors, either
+ *  exponentially decayed or over a sliding window of the latest points,
+ *  and refits a Kent distribution to them. A refit starts the optimizer
+ *  from the previous solution and costs the same however many points
+ *  have been seen.
+ */
+class OnlineEstimator
+{
+  private:
+    string type;
+
+    int mode;
+
+    long double decay;        // weight kept by the past at each new point
+
+    int window;
+
+    struct SufficientStatistics stats;
+
+    std::vector<Vector> ring; // points in the window (SLIDING_WINDOW)
+
+    int head;
+
+    long seen;
+
+    struct Estimates estimates;
+
+    bool fitted;
+
+    void addToStatistics(Vector &, long double);
+
+  public:
+    OnlineEstimator(string, int, long double);
+
+    void add(Vector &);
+
+    void add(std::vector<Vector> &);
+
+    struct Estimates refit();
+
+    struct Estimates getEstimates();
+
+    struct SufficientStatistics getStatistics();
+
+    long double effectiveSampleSize();
+
+    long numberOfPoints();
+
+    void reset();
+};
+
+#endif
+
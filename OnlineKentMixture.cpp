@@ -0,0 +1,165 @@
+#include "OnlineKentMixture.h"
+#include "Statistics.h"
+
+/*!
+ *  Constructor
+ *  \param K the number of components
+ *  \param type estimation of the components (as KentMixture)
+ *  \param decay the decay factor per point in (0,1]
+ *  \param batch_size the number of points per EM step
+ */
+OnlineKentMixture::OnlineKentMixture(int K, string type, long double decay, int batch_size) :
+                                     K(K), decay(decay), batch_size(batch_size),
+                                     mixture(K,type)
+{
+  assert(decay > 0 && decay <= 1);
+  assert(batch_size >= K);
+  reset();
+}
+
+OnlineKentMixture::OnlineKentMixture(
+  int K, string type, long double decay, int batch_size, int num_threads
+) : OnlineKentMixture(K,type,decay,batch_size)
+{
+  mixture = KentMixture(K,type,num_threads);
+}
+
+void OnlineKentMixture::reset()
+{
+  buffer.clear();
+  stats.clear();
+  seen = 0;
+  batches = 0;
+  batch_log_likelihood = 0;
+  fitted = false;
+}
+
+/*!
+ *  \brief Adds 3D unit vectors (row-major). Whole batches are processed
+ *  in place; the rest waits in the buffer for the next points.
+ *  \param x the points
+ *  \param rows the number of points
+ */
+void OnlineKentMixture::add(const double *x, long rows)
+{
+  long first = 0;
+  if (buffer.size() > 0) {
+    long wanted = std::min(batch_size - (long) buffer.size() / 3,rows);
+    buffer.insert(buffer.end(),x,x + 3 * wanted);
+    first = wanted;
+    if (buffer.size() == 3 * batch_size) {
+      step(&buffer[0],batch_size);
+      buffer.clear();
+    }
+  }
+  for (; first+batch_size<=rows; first+=batch_size) {
+    step(x + 3 * first,batch_size);
+  }
+  buffer.insert(buffer.end(),x + 3 * first,x + 3 * rows);
+}
+
+void OnlineKentMixture::add(std::vector<Vector> &sample)
+{
+  std::vector<double> points(3 * sample.size());
+  for (long i=0; i<sample.size(); i++) {
+    for (int j=0; j<3; j++) {
+      points[3*i+j] = sample[i][j];
+    }
+  }
+  add(&points[0],sample.size());
+}
+
+/*!
+ *  \brief Processes the points left in the buffer as a (short) batch
+ */
+void OnlineKentMixture::flush()
+{
+  long rows = buffer.size() / 3;
+  if (rows == 0 || (!fitted && rows < K)) return;
+  step(&buffer[0],rows);
+  buffer.clear();
+}
+
+/*!
+ *  \brief One EM step on a batch: the statistics decay by decay^rows, the
+ *  batch statistics are added and the components refitted. The first
+ *  batch is fitted by EM to convergence.
+ */
+void OnlineKentMixture::step(const double *x, long rows)
+{
+  if (!fitted) {
+    mixture.estimate(x,rows);
+    stats = mixture.getStatistics();
+    batch_log_likelihood = mixture.logLikelihood();
+    fitted = true;
+  } else {
+    std::vector<struct SufficientStatistics> batch;
+    batch_log_likelihood = mixture.accumulate(x,rows,batch);
+    long double scale = pow(decay,(long double) rows);
+    for (int k=0; k<K; k++) {
+      stats[k].N = scale * stats[k].N + batch[k].N;
+      for (int i=0; i<3; i++) {
+        stats[k].sum_x[i] = scale * stats[k].sum_x[i] + batch[k].sum_x[i];
+      }
+      stats[k].sum_xx = scale * stats[k].sum_xx + batch[k].sum_xx;
+    }
+    mixture.update(stats);
+  }
+  seen += rows;
+  batches++;
+}
+
+Vector OnlineKentMixture::getWeights()
+{
+  return mixture.getWeights();
+}
+
+std::vector<struct Estimates> OnlineKentMixture::getEstimates()
+{
+  return mixture.getEstimates();
+}
+
+/*!
+ *  \brief The decayed statistics of the components
+ */
+std::vector<struct SufficientStatistics> OnlineKentMixture::getStatistics()
+{
+  return stats;
+}
+
+/*!
+ *  \brief The log likelihood of the last batch under the components before
+ *  they were refitted to it (a held out score of the stream so far; for
+ *  the first batch, that of its fit)
+ */
+long double OnlineKentMixture::batchLogLikelihood()
+{
+  return batch_log_likelihood;
+}
+
+/*!
+ *  \brief The (decayed) number of points the statistics represent
+ */
+long double OnlineKentMixture::effectiveSampleSize()
+{
+  long double N = 0;
+  for (int k=0; k<stats.size(); k++) {
+    N += stats[k].N;
+  }
+  return N;
+}
+
+/*!
+ *  \brief The number of points processed since the last reset (not those
+ *  waiting in the buffer)
+ */
+long OnlineKentMixture::numberOfPoints()
+{
+  return seen;
+}
+
+long OnlineKentMixture::numberOfBatches()
+{
+  return batches;
+}
+
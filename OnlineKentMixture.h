@@ -0,0 +1,74 @@
+#ifndef ONLINE_KENT_MIXTURE_H
+#define ONLINE_KENT_MIXTURE_H
+
+#include "Header.h"
+#include "Support.h"
+#include "KentMixture.h"
+
+/*!
+ *  A Kent mixture fitted to a stream of unit vectors by mini-batch
+ *  (stochastic) EM. Points are taken in batches of a fixed size: the
+ *  E-step of a batch (KentMixture::accumulate()) gives the weighted
+ *  statistics of each component under the current components, which are
+ *  added to the exponentially decayed statistics kept per component (as
+ *  OnlineEstimator, with the decay applied once per batch), and each
+ *  component is refitted to its decayed statistics warm started from its
+ *  previous estimates. The first batch is fitted by full EM. A batch costs
+ *  the same however many points came before it, and a batch handed over
+ *  whole (as the rows of a MappedSample) is not copied.
+ */
+class OnlineKentMixture
+{
+  private:
+    int K;
+
+    long double decay;           // weight kept by the past at each new point
+
+    int batch_size;
+
+    KentMixture mixture;
+
+    std::vector<double> buffer;  // points of an incomplete batch
+
+    std::vector<struct SufficientStatistics> stats;
+
+    long seen;
+
+    long batches;
+
+    long double batch_log_likelihood;
+
+    bool fitted;
+
+    void step(const double *, long);
+
+  public:
+    OnlineKentMixture(int, string, long double, int);
+
+    OnlineKentMixture(int, string, long double, int, int);
+
+    void add(const double *, long);
+
+    void add(std::vector<Vector> &);
+
+    void flush();
+
+    Vector getWeights();
+
+    std::vector<struct Estimates> getEstimates();
+
+    std::vector<struct SufficientStatistics> getStatistics();
+
+    long double batchLogLikelihood();
+
+    long double effectiveSampleSize();
+
+    long numberOfPoints();
+
+    long numberOfBatches();
+
+    void reset();
+};
+
+#endif
+
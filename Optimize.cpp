@@ -1,7 +1,21 @@
 #include "Optimize.h"
+#include "ScaleSolver.h"
+#include "ThreadPool.h"
 
-Optimize::Optimize(string type)
+#include <chrono>
+
+Optimize::Optimize(string type) : parameterization(ROTATION_VECTOR), shared_best(NULL)
 {
+  summary.num_minimizations = 0;
+  summary.iterations = 0;
+  summary.objective_evaluations = 0;
+  summary.gradient_evaluations = 0;
+  summary.normalizer_evaluations = 0;
+  summary.wall_time = 0;
+  summary.max_wall_time = 0;
+  for (int i=0; i<NUM_STOP_REASONS; i++) {
+    summary.terminations[i] = 0;
+  }
   if (type.compare("MOMENT") == 0) {
     estimation = MOMENT;
   } else if (type.compare("MLE_UNCONSTRAINED") == 0) {
@@ -12,10 +26,22 @@ Optimize::Optimize(string type)
     estimation = MML_SCALE;
   } else if (type.compare("MML") == 0) {
     estimation = MML;
+  } else if (type.compare("MLE_NEWTON") == 0) {
+    estimation = MLE_NEWTON;
   }
 }
 
-void Optimize::initialize(int sample_size, Vector &m0, Vector &m1, Vector &m2, long double k, long double b)
+/*!
+ *  \brief Selects the orientation parameters used by MLE_UNCONSTRAINED and
+ *  MML: ROTATION_VECTOR (default) or ANGLES
+ */
+void Optimize::setParameterization(int type)
+{
+  assert(type == ANGLES || type == ROTATION_VECTOR);
+  parameterization = type;
+}
+
+void Optimize::initialize(long double sample_size, Vector &m0, Vector &m1, Vector &m2, long double k, long double b)
 {
   N = sample_size;
   mean = m0;
@@ -37,7 +63,7 @@ void Optimize::computeEstimates(Vector &sample_mean, Matrix &S, struct Estimates
   switch(estimation) {
     case MOMENT:
     {
-      column_vector theta = minimize(sample_mean,S,2);
+      column_vector theta = minimize(sample_mean,S,2).solution;
       estimates.kappa = theta(0);
       estimates.beta = theta(1);
       break;
@@ -45,21 +71,25 @@ void Optimize::computeEstimates(Vector &sample_mean, Matrix &S, struct Estimates
 
     case MLE_UNCONSTRAINED:
     {
-      column_vector theta = minimize(sample_mean,S,5);
-      finalize(theta,estimates);
+      column_vector theta = minimize(sample_mean,S,5).solution;
+      if (parameterization == ROTATION_VECTOR) {
+        finalizeRotation(theta,estimates);
+      } else {
+        finalize(theta,estimates);
+      }
       break;
     }
 
     case MLE_CONSTRAINED:
     {
-      column_vector theta = minimize(sample_mean,S,7);
+      column_vector theta = minimize(sample_mean,S,7).solution;
       finalize(theta,estimates);
       break;
     }
 
     case MML_SCALE:
     {
-      column_vector theta = minimize(sample_mean,S,2);
+      column_vector theta = minimize(sample_mean,S,2).solution;
       estimates.kappa = theta(0);
       estimates.beta = theta(1);
       break;
@@ -67,13 +97,106 @@ void Optimize::computeEstimates(Vector &sample_mean, Matrix &S, struct Estimates
 
     case MML:
     {
-      column_vector theta = minimize(sample_mean,S,5);
+      column_vector theta = minimize(sample_mean,S,5).solution;
+      if (parameterization == ROTATION_VECTOR) {
+        double k,b;
+        MMLObjectiveFunctionRotation::getScale(theta(3),theta(4),k,b);
+        theta(3) = k;
+        theta(4) = b;
+        finalizeRotation(theta,estimates);
+      } else {
+        finalize(theta,estimates);
+      }
+      break;
+    }
+
+    case MLE_NEWTON:
+    {
+      column_vector theta = minimize(sample_mean,S,5).solution;
       finalize(theta,estimates);
       break;
     }
   }
 }
 
+/*!
+ *  \brief Runs the estimation from several starting points in parallel and
+ *  keeps the best. The starts are the initial values, the initial values
+ *  with the major and minor axes swapped, and random perturbations of
+ *  both (axes rotated by up to MULTI_START_ANGLE; kappa and beta scaled by
+ *  up to exp(MULTI_START_SCALE)). The starts share the best objective
+ *  value found so far and a start that stays more than ABANDON_MARGIN
+ *  above it is abandoned. Meant for MLE and MML, whose objectives have 
+ *  local minima where the major and minor axes are nearly exchangeable.
+ *  \param sample_mean a reference to a Vector (\sum x)
+ *  \param S a reference to a Matrix (\sum x x')
+ *  \param estimates a reference to an Estimates
+ *  \param num_starts the number of starting points (>= 1)
+ *  \param num_threads the number of threads
+ */
+void Optimize::computeEstimatesMultiStart(
+  Vector &sample_mean, 
+  Matrix &S, 
+  struct Estimates &estimates,
+  int num_starts,
+  int num_threads
+) {
+  // starting points (drawn here: rand() is not thread safe)
+  std::vector<struct Estimates> starts(num_starts);
+  Matrix R(3,3);
+  Vector w(3,0);
+  for (int i=0; i<num_starts; i++) {
+    starts[i].mean = mean;
+    starts[i].major_axis = (i % 2) ? minor : major;
+    starts[i].minor_axis = (i % 2) ? major : minor;
+    starts[i].kappa = kappa;
+    starts[i].beta = beta;
+    if (i < 2) continue;
+    long double angle = MULTI_START_ANGLE * (rand() / (long double) RAND_MAX);
+    long double theta = acos(1 - 2 * (rand() / (long double) RAND_MAX));
+    long double phi = 2 * PI * (rand() / (long double) RAND_MAX);
+    w[0] = angle * sin(theta) * cos(phi);
+    w[1] = angle * sin(theta) * sin(phi);
+    w[2] = angle * cos(theta);
+    computeRotationMatrix(w,R);
+    starts[i].mean = prod(R,starts[i].mean);
+    starts[i].major_axis = prod(R,starts[i].major_axis);
+    starts[i].minor_axis = prod(R,starts[i].minor_axis);
+    starts[i].kappa *= exp(MULTI_START_SCALE * (2 * (rand() / (long double) RAND_MAX) - 1));
+    starts[i].beta *= exp(MULTI_START_SCALE * (2 * (rand() / (long double) RAND_MAX) - 1));
+    if (2 * starts[i].beta >= starts[i].kappa) {
+      starts[i].beta = 0.49 * starts[i].kappa;
+    }
+  }
+
+  std::atomic<double> best(std::numeric_limits<double>::max());
+  std::vector<Optimize> fits(num_starts,*this);
+  {
+    ThreadPool pool(num_threads);
+    for (int i=0; i<num_starts; i++) {
+      pool.submit([&,i] {
+        struct Estimates &start = starts[i];
+        fits[i].shared_best = &best;
+        fits[i].initialize(N,start.mean,start.major_axis,start.minor_axis,
+                           start.kappa,start.beta);
+        fits[i].computeEstimates(sample_mean,S,start);
+      });
+    }
+    pool.wait();
+  }
+
+  int best_start = 0;
+  for (int i=0; i<num_starts; i++) {
+    struct OptimizeResult &fit = fits[i].result;
+    if (fit.objective < fits[best_start].result.objective) {
+      best_start = i;
+    }
+    addToSummary(fit);
+  }
+  result = fits[best_start].result;
+  estimates = starts[best_start];
+}
+
 void Optimize::finalize(column_vector &theta, struct Estimates &estimates)
 {
   double alpha_f = theta(0);
@@ -85,14 +208,12 @@ void Optimize::finalize(column_vector &theta, struct Estimates &estimates)
   double tmp = -1/(tan(alpha_f) * tan(psi_f));
   double delta_f;
   if (fabs(tmp) > 1) { 
-    cout << "yesf, tmp: " << tmp << endl;;
     psi_f = psi;
     delta_f = delta;
   } else {
     double acos_tmp = acos(tmp);
     delta_f = eta_f + acos_tmp;
     if (!(delta_f >= eta_f && delta_f <= PI+eta_f)) {
-      cout << "yes2\n";
       delta_f = eta_f - acos_tmp;
       assert(delta_f >= eta_f && delta_f <= PI+eta_f);
     }
@@ -105,30 +226,71 @@ void Optimize::finalize(column_vector &theta, struct Estimates &estimates)
   estimates.beta = theta(4);
 }
 
-column_vector Optimize::minimize(Vector &sample_mean, Matrix &S, int num_params)
+/*!
+ *  \brief Estimates from theta = (w,k,b): the initial axes rotated by w
+ */
+void Optimize::finalizeRotation(column_vector &theta, struct Estimates &estimates)
+{
+  double k = theta(3), b = theta(4);
+  LocalRotation frame(mean,major);
+  frame.rotate(theta(0),theta(1),theta(2));
+  frame.makeCanonical(k,b);
+  estimates.mean = frame.Mean();
+  estimates.major_axis = frame.MajorAxis();
+  estimates.minor_axis = frame.MinorAxis();
+  estimates.kappa = k;
+  estimates.beta = b;
+}
+
+/*!
+ *  \brief Minimizes the objective of the estimation type from the
+ *  initial values; the telemetry of the run is returned with the
+ *  solution and added to the summary of this object.
+ */
+struct OptimizeResult Optimize::minimize(Vector &sample_mean, Matrix &S, int num_params)
 {
   column_vector starting_point(num_params);
+  result.objective = 0;
+  result.iterations = 0;
+  result.objective_evaluations = 0;
+  result.gradient_evaluations = 0;
+  result.termination = STOP_NONE;
+  result.gradient_norm = 0;
+  long normalizer_start = Kent::normalizerEvaluations();
+  auto start = std::chrono::steady_clock::now();
+
   switch(estimation) {
     case MOMENT:
+    case MML_SCALE:
     {
-      starting_point = kappa,beta; 
-      find_min_using_approximate_derivatives(
-        bfgs_search_strategy(),
-        objective_delta_stop_strategy(1e-10),
-        MomentObjectiveFunction(mean,major,minor,sample_mean,S,N),
-        starting_point,
-        -100
-      );
+      // two parameters: solved by ScaleSolver instead of dlib
+      long double k = kappa,b = beta;
+      ScaleSolver solver(estimation,mean,major,minor,sample_mean,S,N);
+      result.objective = solver.minimize(k,b,result);
+      starting_point = k,b;
       break;
     }
 
     case MLE_UNCONSTRAINED:
     {
+      if (parameterization == ROTATION_VECTOR) {
+        starting_point = 0,0,0,kappa,beta; 
+        result.objective = find_min(
+          bfgs_search_strategy(),
+          TelemetryStopStrategy(1e-10,&result,shared_best,ABANDON_MARGIN),
+          counted(MaximumLikelihoodObjectiveFunctionRotation(mean,major,sample_mean,S,N),&result.objective_evaluations),
+          counted(MaximumLikelihoodGradientRotation(mean,major,sample_mean,S,N),&result.gradient_evaluations),
+          starting_point,
+          -100
+        );
+        break;
+      }
       starting_point = alpha,eta,psi,kappa,beta; 
-      find_min_using_approximate_derivatives(
+      result.objective = find_min(
         bfgs_search_strategy(),
-        objective_delta_stop_strategy(1e-10),
-        MaximumLikelihoodObjectiveFunctionUnconstrained(sample_mean,S,N,starting_point),
+        TelemetryStopStrategy(1e-10,&result,shared_best,ABANDON_MARGIN),
+        counted(MaximumLikelihoodObjectiveFunctionUnconstrained(sample_mean,S,N,starting_point),&result.objective_evaluations),
+        counted(MaximumLikelihoodGradientUnconstrained(sample_mean,S,N,starting_point),&result.gradient_evaluations),
         starting_point,
         -100
       );
@@ -142,38 +304,55 @@ column_vector Optimize::minimize(Vector &sample_mean, Matrix &S, int num_params)
       column_vector max_values(num_params);
       min_values = -1e10,-1e10,-1e10,0,0,1e-10,1e-10;
       max_values = uniform_matrix<double>(num_params,1,1e10);
-      find_min_box_constrained(
+      result.objective = find_min_box_constrained(
         bfgs_search_strategy(),  
-        objective_delta_stop_strategy(1e-9),  
-        MaximumLikelihoodObjectiveFunctionConstrained(sample_mean,S,N,starting_point), 
-        derivative(MaximumLikelihoodObjectiveFunctionConstrained(sample_mean,S,N,starting_point)), 
+        TelemetryStopStrategy(1e-9,&result,shared_best,ABANDON_MARGIN),  
+        counted(MaximumLikelihoodObjectiveFunctionConstrained(sample_mean,S,N,starting_point),&result.objective_evaluations), 
+        derivative(counted(MaximumLikelihoodObjectiveFunctionConstrained(sample_mean,S,N,starting_point),&result.objective_evaluations)), 
         starting_point,min_values,max_values 
       );
       break;
     }
 
-    case MML_SCALE:
+    case MML:
     {
-      starting_point = kappa,beta; 
-      find_min_using_approximate_derivatives(
+      if (parameterization == ROTATION_VECTOR) {
+        double x3,x4;
+        MMLObjectiveFunctionRotation::setScale(kappa,beta,x3,x4);
+        starting_point = 0,0,0,x3,x4; 
+        result.objective = find_min(
+          bfgs_search_strategy(),
+          TelemetryStopStrategy(1e-10,&result,shared_best,ABANDON_MARGIN),
+          counted(MMLObjectiveFunctionRotation(mean,major,sample_mean,S,N),&result.objective_evaluations),
+          counted(MMLGradientRotation(mean,major,sample_mean,S,N),&result.gradient_evaluations),
+          starting_point,
+          -100
+        );
+        break;
+      }
+      starting_point = alpha,eta,psi,kappa,beta; 
+      result.objective = find_min(
         bfgs_search_strategy(),
-        objective_delta_stop_strategy(1e-10),
-        MMLObjectiveFunctionScale(alpha,eta,psi,delta,sample_mean,S,N),
+        TelemetryStopStrategy(1e-10,&result,shared_best,ABANDON_MARGIN),
+        counted(MMLObjectiveFunction(sample_mean,S,N,starting_point),&result.objective_evaluations),
+        counted(MMLGradient(sample_mean,S,N,starting_point),&result.gradient_evaluations),
         starting_point,
         -100
       );
       break;
     }
 
-    case MML:
+    case MLE_NEWTON:
     {
-      starting_point = alpha,eta,psi,kappa,beta; 
-      find_min_using_approximate_derivatives(
-        bfgs_search_strategy(),
-        objective_delta_stop_strategy(1e-10),
-        MMLObjectiveFunction(sample_mean,S,N,starting_point),
+      // delta = eta + acos(.) in the model: if the major axis lies on
+      // the other branch, start from its antipode (the same axis)
+      double psi0 = (sin(delta - eta) < 0) ? PI - psi : psi;
+      starting_point = alpha,eta,psi0,kappa,beta; 
+      result.objective = find_min_trust_region(
+        TelemetryStopStrategy(1e-10,&result,shared_best,ABANDON_MARGIN),
+        CountedModel<MaximumLikelihoodNewtonModel>(MaximumLikelihoodNewtonModel(sample_mean,S,N),&result),
         starting_point,
-        -100
+        1   // initial trust region radius
       );
       break;
     }
@@ -193,7 +372,54 @@ column_vector Optimize::minimize(Vector &sample_mean, Matrix &S, int num_params)
                   1e-6,  // stopping trust region radius
                   100    // max number of objective function evaluations
   );*/
-  cout << "solution:\n" << starting_point << endl;
-  return starting_point;
+  auto end = std::chrono::steady_clock::now();
+  result.solution = starting_point;
+  result.wall_time = std::chrono::duration<double,std::milli>(end-start).count();
+  result.normalizer_evaluations = Kent::normalizerEvaluations() - normalizer_start;
+  if (result.termination == STOP_NONE) {
+    result.termination = STOP_MIN_OBJECTIVE;
+  }
+
+  addToSummary(result);
+  return result;
+}
+
+void Optimize::addToSummary(struct OptimizeResult &run)
+{
+  summary.num_minimizations++;
+  summary.iterations += run.iterations;
+  summary.objective_evaluations += run.objective_evaluations;
+  summary.gradient_evaluations += run.gradient_evaluations;
+  summary.normalizer_evaluations += run.normalizer_evaluations;
+  summary.wall_time += run.wall_time;
+  if (run.wall_time > summary.max_wall_time) {
+    summary.max_wall_time = run.wall_time;
+  }
+  summary.terminations[run.termination]++;
+}
+
+struct OptimizeResult Optimize::getResult()
+{
+  return result;
+}
+
+struct OptimizeSummary Optimize::getSummary()
+{
+  return summary;
+}
+
+void Optimize::printSummary(ostream &os)
+{
+  long n = summary.num_minimizations;
+  os << "minimizations: " << n << "; iterations: " << summary.iterations
+     << "; objective evaluations: " << summary.objective_evaluations
+     << "; gradient evaluations: " << summary.gradient_evaluations
+     << "; normalizer evaluations: " << summary.normalizer_evaluations << endl;
+  os << "wall time: " << summary.wall_time << " ms (mean " 
+     << (n ? summary.wall_time / n : 0) << " ms, max " << summary.max_wall_time << " ms)"
+     << "; stopped on objective delta: " << summary.terminations[STOP_OBJECTIVE_DELTA]
+     << ", max iterations: " << summary.terminations[STOP_MAX_ITERATIONS]
+     << ", min objective: " << summary.terminations[STOP_MIN_OBJECTIVE]
+     << ", abandoned: " << summary.terminations[STOP_ABANDONED] << endl;
 }
 
@@ -3,19 +3,235 @@
 
 #include <dlib/optimization.h>
 #include "Kent.h"
+#include "DualKent.h"
+
+#include <atomic>
 
 using namespace dlib;
 
 typedef dlib::matrix<double,0,1> column_vector;
 
+// why a minimization stopped
+#define STOP_NONE 0
+#define STOP_OBJECTIVE_DELTA 1    // objective changed less than the tolerance
+#define STOP_MAX_ITERATIONS 2
+#define STOP_MIN_OBJECTIVE 3      // objective fell below the given lower bound
+#define STOP_ABANDONED 4          // fell behind the best start of a multi-start
+#define NUM_STOP_REASONS 5
+
+// multi-start search
+#define MULTI_START_ANGLE 0.5        // largest rotation of a perturbed start (radians)
+#define MULTI_START_SCALE 0.5        // largest change of log(kappa), log(beta)
+#define ABANDON_MARGIN 5             // objective above the best start by this ...
+#define ABANDON_MIN_ITERATIONS 3     // ... after this many iterations: abandon
+#define MIN_ECCENTRICITY 1e-6        // bound on 2b/k, 1-2b/k in the MML search
+
+// telemetry of one minimization
+struct OptimizeResult
+{
+  column_vector solution;
+  double objective;
+  long iterations;
+  long objective_evaluations;   // including those of numerical derivatives
+  long gradient_evaluations;    // analytic gradients (with Hessians)
+  long normalizer_evaluations;  // series summed (Kent::normalizerEvaluations())
+  double wall_time;             // milliseconds
+  int termination;              // STOP_...
+  double gradient_norm;         // at the solution
+};
+
+// telemetry summed over the minimizations of an Optimize object
+struct OptimizeSummary
+{
+  long num_minimizations;
+  long iterations;
+  long objective_evaluations;
+  long gradient_evaluations;
+  long normalizer_evaluations;
+  double wall_time,max_wall_time;  // milliseconds
+  long terminations[NUM_STOP_REASONS];
+};
+
+/*!
+ *  Stops when the objective changes by less than min_delta between
+ *  iterations (as dlib's objective_delta_stop_strategy) and records the
+ *  iterations, the gradient norm and the reason for stopping.
+ *  Given the best objective shared by the starts of a multi-start search,
+ *  it also lowers that value and abandons a start that stays more than
+ *  margin above it.
+ */
+class TelemetryStopStrategy
+{
+  private:
+    double min_delta;
+
+    struct OptimizeResult *result;
+
+    std::atomic<double> *shared_best;
+
+    double margin;
+
+    unsigned long max_iter,cur_iter;  // max_iter = 0: no limit
+
+    double prev_funct_value;
+
+  public:
+    TelemetryStopStrategy(double min_delta, struct OptimizeResult *result,
+                          std::atomic<double> *shared_best = NULL, double margin = 0,
+                          unsigned long max_iter = 0) :
+                          min_delta(min_delta), result(result), shared_best(shared_best),
+                          margin(margin), max_iter(max_iter), cur_iter(0), 
+                          prev_funct_value(0)
+    {}
+
+    template <typename T>
+    bool should_continue_search(const T &, const double funct_value, const T &funct_derivative) {
+      result->gradient_norm = length(funct_derivative);
+      if (shared_best != NULL) {
+        double best = shared_best->load();
+        while (funct_value < best && !shared_best->compare_exchange_weak(best,funct_value));
+        if (cur_iter >= ABANDON_MIN_ITERATIONS && funct_value > best + margin) {
+          result->iterations = cur_iter;
+          result->termination = STOP_ABANDONED;
+          return false;
+        }
+      }
+      if (cur_iter++ > 0) {
+        result->iterations = cur_iter - 1;
+        if (max_iter != 0 && cur_iter > max_iter) {
+          result->termination = STOP_MAX_ITERATIONS;
+          return false;
+        }
+        if (std::abs(prev_funct_value - funct_value) < min_delta) {
+          result->termination = STOP_OBJECTIVE_DELTA;
+          return false;
+        }
+      }
+      prev_funct_value = funct_value;
+      return true;
+    }
+};
+
+/*!
+ *  Counts the calls of an objective function (or of its gradient)
+ */
+template <class F>
+class CountedFunction
+{
+  private:
+    F f;
+
+    long *count;
+
+  public:
+    CountedFunction(const F &f, long *count) : f(f), count(count)
+    {}
+
+    template <typename T>
+    auto operator() (const T &x) const -> decltype(f(x)) {
+      (*count)++;
+      return f(x);
+    }
+};
+
+template <class F>
+CountedFunction<F> counted(const F &f, long *count)
+{
+  return CountedFunction<F>(f,count);
+}
+
+/*!
+ *  Counts the calls of a find_min_trust_region() model
+ */
+template <class M>
+class CountedModel
+{
+  private:
+    M model;
+
+    struct OptimizeResult *result;
+
+  public:
+    typedef typename M::column_vector column_vector;
+    typedef typename M::general_matrix general_matrix;
+
+    CountedModel(const M &model, struct OptimizeResult *result) : 
+                 model(model), result(result)
+    {}
+
+    double operator() (const column_vector& x) const {
+      result->objective_evaluations++;
+      return model(x);
+    }
+
+    void get_derivative_and_hessian(
+      const column_vector& x, column_vector& der, general_matrix& hess
+    ) const {
+      result->gradient_evaluations++;
+      model.get_derivative_and_hessian(x,der,hess);
+    }
+};
+
+/*!
+ *  Workspace of an objective function: the sufficient statistics are 
+ *  held by reference and the Kent object (axes, constants, differentials)
+ *  is re-parameterized in place. Once its storage has been sized by the 
+ *  first evaluation, an evaluation does no heap allocation.
+ */
+class EvaluationContext
+{
+  private:
+    const Vector &sample_mean;
+
+    const Matrix &S;
+
+    long double N;
+
+    Kent kent;
+
+  public:
+    EvaluationContext(const Vector &sample_mean, const Matrix &S, long double N) :
+                      sample_mean(sample_mean), S(S), N(N)
+    {}
+
+    Kent &set(double alpha, double eta, double psi, double delta, double k, double b) {
+      kent.setParameters(alpha,eta,psi,delta,k,b);
+      return kent;
+    }
+
+    Kent &setAxes(const Vector &m0, const Vector &m1, double k, double b) {
+      kent.setAxes(m0,m1,k,b);
+      return kent;
+    }
+
+    Kent &setScale(double k, double b) {
+      kent.setScale(k,b);
+      return kent;
+    }
+
+    long double negativeLogLikelihood() {
+      return kent.computeNegativeLogLikelihood(sample_mean,S,N);
+    }
+
+    void derivatives(Vector &gradient, Matrix &hessian) {
+      kent.computeDerivativesNegativeLogLikelihood(sample_mean,S,N,gradient,hessian,1);
+    }
+
+    long double sampleSize() const {
+      return N;
+    }
+};
+
 class MomentObjectiveFunction
 {
   private:
     long double C1,C2;
 
+    mutable Kent kent;
+
   public:
     MomentObjectiveFunction(Vector &m0, Vector &m1, Vector &m2,
-                            Vector &sample_mean, Matrix &S, int sample_size) {
+                            Vector &sample_mean, Matrix &S, long double sample_size) {
       C1 = computeDotProduct(sample_mean,m0) / sample_size;
 
       long double mj = prod_xMy(m1,S,m1);
@@ -30,29 +246,101 @@ class MomentObjectiveFunction
       const double k = x(0);
       const double b = x(1);
 
-      Kent kent(k,b);
+      kent.setScale(k,b);
       long double log_norm = kent.computeLogNormalizationConstant();
       double fval = log_norm - k * C1 - b * C2;
       return fval;
     }
 }; 
 
+class MomentObjectiveGradient
+{
+  private:
+    long double C1,C2;
+
+    mutable Kent kent;
+
+  public:
+    MomentObjectiveGradient(Vector &m0, Vector &m1, Vector &m2,
+                            Vector &sample_mean, Matrix &S, long double sample_size) {
+      C1 = computeDotProduct(sample_mean,m0) / sample_size;
+
+      long double mj = prod_xMy(m1,S,m1);
+      long double mi = prod_xMy(m2,S,m2);
+      C2 = (mj - mi) / sample_size;
+    }
+
+    /*!
+     *  gradient: (c_k/c - a, c_b/c - delta)
+     */
+    column_vector operator() (const column_vector& x) const {
+      const double k = x(0);
+      const double b = x(1);
+
+      kent.setScale(k,b);
+      Vector dlog_norm = kent.computeGradientLogNormalizationConstant();
+      column_vector gradient(2);
+      gradient(0) = dlog_norm[0] - C1;
+      gradient(1) = dlog_norm[1] - C2;
+      return gradient;
+    }
+};
+
+/*!
+ *  \brief (alpha,eta,psi,delta) of x = (alpha,eta,psi,...) as dual numbers
+ *  seeded as the variables 0-2, with delta solved as by the objectives.
+ *  Where the angles admit no major axis the objectives fall back to the
+ *  initial angles, which are then constants.
+ *  \param init the initial (alpha,eta,psi,delta)
+ */
+inline void computeDualAngles(const column_vector &x, const double *init, KentDual *angles)
+{
+  KentDual alpha = KentDual::variable(x(0),0);
+  KentDual eta = KentDual::variable(x(1),1);
+  KentDual psi = KentDual::variable(x(2),2);
+  KentDual tmp = -1/(tan(alpha) * tan(psi));
+  if (fabs(fabs(tmp.value)-1) < TOLERANCE) {
+    tmp = (tmp.value < 0) ? -1 : 1;
+  }
+  if (fabs(tmp.value) > 1) {
+    for (int i=0; i<4; i++) angles[i] = init[i];
+    return;
+  }
+  // acos has no derivative at the clamped values
+  KentDual acos_tmp = (fabs(tmp.value) == 1) ? KentDual(acos(tmp.value)) : acos(tmp);
+  KentDual delta = eta + acos_tmp;
+  if (!(delta >= eta && delta <= PI+eta)) {
+    delta = eta - acos_tmp;
+  }
+  angles[0] = alpha; angles[1] = eta; angles[2] = psi; angles[3] = delta;
+}
+
+/*!
+ *  \brief The gradient of a dual number as a column_vector
+ */
+inline column_vector gradientOf(const KentDual &f)
+{
+  column_vector gradient(NUM_KENT_PARAMETERS);
+  for (int i=0; i<NUM_KENT_PARAMETERS; i++) {
+    gradient(i) = boost::math::isnan(f.d[i]) ? 0 : f.d[i];
+  }
+  return gradient;
+}
+
 // MLE Unconstrained
 class MaximumLikelihoodObjectiveFunctionUnconstrained
 {
   private:
-    Vector sample_mean;
+    mutable EvaluationContext context;
 
-    Matrix S;
-
-    int N;
+    long double N;
 
     double alpha_init,eta_init,psi_init,delta_init;
 
   public:
     MaximumLikelihoodObjectiveFunctionUnconstrained(
-      Vector &sample_mean, Matrix &S, int sample_size, column_vector &sp
-    ) : sample_mean(sample_mean), S(S), N(sample_size)
+      Vector &sample_mean, Matrix &S, long double sample_size, column_vector &sp
+    ) : context(sample_mean,S,sample_size), N(sample_size)
     {
       alpha_init = sp(0);
       eta_init = sp(1);
@@ -74,22 +362,16 @@ class MaximumLikelihoodObjectiveFunctionUnconstrained
       double k = x(3);
       double b = x(4);
 
-      Vector m0(3,0),m1(3,0),m2,spherical(3,0);
-      spherical[0] = 1;
-      // compute m0
-      spherical[1] = alpha; spherical[2] = eta;
-      spherical2cartesian(spherical,m0);
-      // compute m1
+      // m0: (alpha,eta); m1: (psi,delta); m2: m0 X m1
       // cos(delta-eta) = -cot(alpha) cot(psi)
+      // (no major axis for these angles: fall back to the initial ones)
       double tmp = -1/(tan(alpha) * tan(psi));
       double delta;
-      if (fabs(tmp)-1 < TOLERANCE) {
-        cout << "here\n";
+      if (fabs(fabs(tmp)-1) < TOLERANCE) {
         if (tmp < 0) tmp = -1;
         else if (tmp > 0) tmp = 1;
       }
       if (fabs(tmp) > 1) {
-        cout << "yes, tmp: " << tmp << endl;;
         alpha = alpha_init;
         eta = eta_init;
         psi = psi_init;
@@ -98,42 +380,288 @@ class MaximumLikelihoodObjectiveFunctionUnconstrained
         double acos_tmp = acos(tmp);
         delta = eta + acos_tmp;
         if (!(delta >= eta && delta <= PI+eta)) {
-          cout << "yes2\n";
           delta = eta - acos_tmp;
           assert(delta >= eta && delta <= PI+eta);
         }
       }
-      spherical[1] = psi;
-      spherical[2] = delta;
-      spherical2cartesian(spherical,m1);
-      // compute m2: m0 X m1
-      m2 = crossProduct(m0,m1);
-
-      Kent kent(m0,m1,m2,k,b);
-      Vector sample_mean1 = sample_mean; Matrix S1 = S;
-      double fval = kent.computeNegativeLogLikelihood(sample_mean1,S1,N)
-                    - 2 * N * log(AOM);
+
+      context.set(alpha,eta,psi,delta,k,b);
+      double fval = context.negativeLogLikelihood() - 2 * N * log(AOM);
+      assert(!boost::math::isnan(fval));
+      return fval;
+    }
+};
+
+/*!
+ *  Exact gradient of MaximumLikelihoodObjectiveFunctionUnconstrained
+ *  (forward mode differentiation through DualKent)
+ */
+class MaximumLikelihoodGradientUnconstrained
+{
+  private:
+    const Vector &sample_mean;
+
+    const Matrix &S;
+
+    long double N;
+
+    double init[4];
+
+    mutable DualKent kent;
+
+  public:
+    MaximumLikelihoodGradientUnconstrained(
+      Vector &sample_mean, Matrix &S, long double sample_size, column_vector &sp
+    ) : sample_mean(sample_mean), S(S), N(sample_size)
+    {
+      init[0] = sp(0);
+      init[1] = sp(1);
+      init[2] = sp(2);
+      double tmp = -1/(tan(init[0]) * tan(init[2]));
+      init[3] = init[1] + acos(tmp);
+    }
+
+    column_vector operator() (const column_vector& x) const {
+      KentDual angles[4];
+      computeDualAngles(x,init,angles);
+      KentDual k = KentDual::variable(x(3),3);
+      KentDual b = KentDual::variable(x(4),4);
+      kent.setParameters(angles[0],angles[1],angles[2],angles[3],k,b);
+      return gradientOf(kent.negativeLogLikelihood(sample_mean,S,N));
+    }
+};
+
+/*!
+ *  Orientation as a rotation vector w applied to a reference frame: the
+ *  mean and major axis are R(w) m0 and R(w) m1. Unlike the angles, with
+ *  delta solved from cos(delta-eta) = -cot(alpha) cot(psi), every w
+ *  gives a valid frame and the axes are smooth functions of w.
+ */
+class LocalRotation
+{
+  private:
+    Vector m0,m1;
+
+    Vector w,mean,major,minor;
+
+    Matrix R;
+
+  public:
+    LocalRotation(const Vector &m0, const Vector &m1) : m0(m0), m1(m1), 
+                  w(3,0), mean(3,0), major(3,0), minor(3,0), R(3,3)
+    {}
+
+    void rotate(double w1, double w2, double w3) {
+      w[0] = w1; w[1] = w2; w[2] = w3;
+      computeRotationMatrix(w,R);
+      for (int i=0; i<3; i++) {
+        mean[i] = R(i,0)*m0[0] + R(i,1)*m0[1] + R(i,2)*m0[2];
+        major[i] = R(i,0)*m1[0] + R(i,1)*m1[1] + R(i,2)*m1[2];
+      }
+    }
+
+    /*!
+     *  \brief The same distribution with k, b >= 0: (m0,-k) is (-m0,k) and
+     *  (mj,mi,-b) is (mi,mj,b). The objectives are thus defined on both 
+     *  sides of k = 0 and b = 0 and the line search can cross them.
+     */
+    void makeCanonical(double &k, double &b) {
+      if (k < 0) {
+        for (int i=0; i<3; i++) mean[i] = -mean[i];
+        k = -k;
+      }
+      crossProduct(mean,major,minor);
+      if (b < 0) {
+        major.swap(minor);
+        b = -b;
+      }
+    }
+
+    const Vector &Mean() const {
+      return mean;
+    }
+
+    const Vector &MajorAxis() const {
+      return major;
+    }
+
+    const Vector &MinorAxis() const {
+      return minor;
+    }
+};
+
+/*!
+ *  \brief LocalRotation::rotate() and makeCanonical() on dual numbers:
+ *  w = x(0..2) are seeded as the variables 0-2; k,b are changed in place.
+ */
+inline void computeDualFrame(
+  const Vector &m0, const Vector &m1, const column_vector &x,
+  KentDual &k, KentDual &b, KentDual *mean, KentDual *major
+) {
+  KentDual w[3],R[3][3];
+  for (int i=0; i<3; i++) {
+    w[i] = KentDual::variable(x(i),i);
+  }
+  computeRotationMatrix3(w,R);
+  for (int i=0; i<3; i++) {
+    mean[i] = R[i][0]*m0[0] + R[i][1]*m0[1] + R[i][2]*m0[2];
+    major[i] = R[i][0]*m1[0] + R[i][1]*m1[1] + R[i][2]*m1[2];
+  }
+  if (k < 0) {
+    for (int i=0; i<3; i++) mean[i] = -mean[i];
+    k = -k;
+  }
+  if (b < 0) {
+    KentDual minor[3];
+    crossProduct3(mean,major,minor);
+    for (int i=0; i<3; i++) major[i] = minor[i];
+    b = -b;
+  }
+}
+
+// MLE Unconstrained: x = (w,k,b)
+class MaximumLikelihoodObjectiveFunctionRotation
+{
+  private:
+    mutable EvaluationContext context;
+
+    mutable LocalRotation frame;
+
+    long double N;
+
+  public:
+    MaximumLikelihoodObjectiveFunctionRotation(
+      Vector &m0, Vector &m1, Vector &sample_mean, Matrix &S, long double sample_size
+    ) : context(sample_mean,S,sample_size), frame(m0,m1), N(sample_size)
+    {}
+
+    /*!
+     *  minimize function: N * log c(k,b) - k  (m0' x) - b (mj' xx' mj -  mi xx' mi)
+     *  with m0 = R(w) m0_init, mj = R(w) mj_init
+     */
+    double operator() (const column_vector& x) const {
+      double k = x(3), b = x(4);
+      frame.rotate(x(0),x(1),x(2));
+      frame.makeCanonical(k,b);
+      context.setAxes(frame.Mean(),frame.MajorAxis(),k,b);
+      double fval = context.negativeLogLikelihood() - 2 * N * log(AOM);
       assert(!boost::math::isnan(fval));
       return fval;
     }
 };
 
+/*!
+ *  Exact gradient of MaximumLikelihoodObjectiveFunctionRotation
+ */
+class MaximumLikelihoodGradientRotation
+{
+  private:
+    Vector m0,m1;
+
+    const Vector &sample_mean;
+
+    const Matrix &S;
+
+    long double N;
+
+    mutable DualKent kent;
+
+  public:
+    MaximumLikelihoodGradientRotation(
+      Vector &m0, Vector &m1, Vector &sample_mean, Matrix &S, long double sample_size
+    ) : m0(m0), m1(m1), sample_mean(sample_mean), S(S), N(sample_size)
+    {}
+
+    column_vector operator() (const column_vector& x) const {
+      KentDual k = KentDual::variable(x(3),3);
+      KentDual b = KentDual::variable(x(4),4);
+      KentDual mean[3],major[3];
+      computeDualFrame(m0,m1,x,k,b,mean,major);
+      kent.setAxes(mean,major,k,b);
+      return gradientOf(kent.negativeLogLikelihood(sample_mean,S,N));
+    }
+};
+
+/*!
+ *  Quadratic model of the MLE objective for find_min_trust_region():
+ *  the exact gradient and Hessian with respect to (alpha,eta,psi,k,b)
+ */
+class MaximumLikelihoodNewtonModel
+{
+  private:
+    mutable EvaluationContext context;
+
+    long double N;
+
+    /*!
+     *  delta from cos(delta-eta) = -cot(alpha) cot(psi)
+     *  \return false if the angles admit no major axis
+     */
+    bool computeDelta(double alpha, double eta, double psi, double &delta) const {
+      double tmp = -1/(tan(alpha) * tan(psi));
+      if (boost::math::isnan(tmp) || fabs(tmp) >= 1) return false;
+      delta = eta + acos(tmp);
+      return true;
+    }
+
+  public:
+    typedef ::column_vector column_vector;
+    typedef dlib::matrix<double> general_matrix;
+
+    MaximumLikelihoodNewtonModel(
+      Vector &sample_mean, Matrix &S, long double sample_size
+    ) : context(sample_mean,S,sample_size), N(sample_size)
+    {}
+
+    /*!
+     *  minimize function: N * log c(k,b) - k  (m0' x) - b (mj' xx' mj -  mi xx' mi)
+     *  (infeasible points are given the largest value so that the 
+     *  trust region shrinks away from them)
+     */
+    double operator() (const column_vector& x) const {
+      double delta;
+      if (x(3) <= 0 || x(4) <= 0 || !computeDelta(x(0),x(1),x(2),delta)) {
+        return std::numeric_limits<double>::max();
+      }
+      context.set(x(0),x(1),x(2),delta,x(3),x(4));
+      return context.negativeLogLikelihood() - 2 * N * log(AOM);
+    }
+
+    void get_derivative_and_hessian(
+      const column_vector& x, column_vector& der, general_matrix& hess
+    ) const {
+      double delta;
+      bool feasible = computeDelta(x(0),x(1),x(2),delta);
+      assert(feasible);
+      context.set(x(0),x(1),x(2),delta,x(3),x(4));
+      Vector gradient;
+      Matrix hessian;
+      context.derivatives(gradient,hessian);
+      der.set_size(5);
+      hess.set_size(5,5);
+      for (int i=0; i<5; i++) {
+        der(i) = gradient[i];
+        for (int j=0; j<5; j++) {
+          hess(i,j) = hessian(i,j);
+        }
+      }
+    }
+};
+
 // MLE Constrained
 class MaximumLikelihoodObjectiveFunctionConstrained
 {
   private:
-    Vector sample_mean;
-
-    Matrix S;
+    mutable EvaluationContext context;
 
-    int N;
+    long double N;
 
     double alpha_init,eta_init,psi_init,delta_init;
 
   public:
     MaximumLikelihoodObjectiveFunctionConstrained(
-      Vector &sample_mean, Matrix &S, int sample_size, column_vector &sp
-    ) : sample_mean(sample_mean), S(S), N(sample_size)
+      Vector &sample_mean, Matrix &S, long double sample_size, column_vector &sp
+    ) : context(sample_mean,S,sample_size), N(sample_size)
     {
       alpha_init = sp(0);
       eta_init = sp(1);
@@ -159,12 +687,7 @@ class MaximumLikelihoodObjectiveFunctionConstrained
 
       if (fabs(k) < 100*TOLERANCE)  k = ZERO;
 
-      Vector m0(3,0),m1(3,0),m2,spherical(3,0);
-      spherical[0] = 1;
-      // compute m0
-      spherical[1] = alpha; spherical[2] = eta;
-      spherical2cartesian(spherical,m0);
-      // compute m1
+      // m0: (alpha,eta); m1: (psi,delta); m2: m0 X m1
       // cos(delta-eta) = -cot(alpha) cot(psi)
       double tmp = -1/(tan(alpha) * tan(psi));
       double delta;
@@ -180,15 +703,9 @@ class MaximumLikelihoodObjectiveFunctionConstrained
         delta = eta - acos_tmp;
         //assert(delta >= eta && delta <= PI+eta);
       }
-      spherical[1] = psi;
-      spherical[2] = delta;
-      spherical2cartesian(spherical,m1);
-      // compute m2: m0 X m1
-      m2 = crossProduct(m0,m1);
-
-      Kent kent(m0,m1,m2,k,b);
-      Vector sample_mean1 = sample_mean; Matrix S1 = S;
-      double fval = kent.computeNegativeLogLikelihood(sample_mean1,S1,N)
+
+      context.set(alpha,eta,psi,delta,k,b);
+      double fval = context.negativeLogLikelihood()
                     - c1 * (1+tmp) + c2 * (tmp - 1) - 2 * N * log(AOM);
       cout << "fval: " << fval << endl;
       assert(!boost::math::isnan(fval));
@@ -199,23 +716,19 @@ class MaximumLikelihoodObjectiveFunctionConstrained
 class MMLObjectiveFunctionScale
 {
   private:
-    Vector sample_mean;
-
-    Matrix S;
+    mutable EvaluationContext context;
 
-    int N;
-
-    double alpha,eta,psi,delta;
+    long double N;
 
     double k2;
 
   public:
     MMLObjectiveFunctionScale(
       double alpha, double eta, double psi, double delta, 
-      Vector &sample_mean, Matrix &S, int sample_size
-    ) : alpha(alpha), eta(eta), psi(psi), delta(delta), N(sample_size),
-        sample_mean(sample_mean), S(S)
+      Vector &sample_mean, Matrix &S, long double sample_size
+    ) : context(sample_mean,S,sample_size), N(sample_size)
     {
+      context.set(alpha,eta,psi,delta,1,0);
       k2 = 0.08019;
     }
 
@@ -231,28 +744,67 @@ class MMLObjectiveFunctionScale
       double k = x(0);
       double b = x(1);
 
-      Kent kent(alpha,eta,psi,delta,k,b);
+      Kent &kent = context.setScale(k,b);
       long double log_prior = kent.computeLogPriorScale();
-      kent.computeExpectation();
+      // the axes are fixed: only the scale constants are needed
+      kent.computeScaleConstants();
       long double log_fisher = kent.computeLogFisherScale() + 2 * log(N);
-      Vector sample_mean1 = sample_mean; Matrix S1 = S;
       double part1 = log(k2) - log_prior + 0.5 * log_fisher;
-      double part2 = kent.computeNegativeLogLikelihood(sample_mean1,S1,N) + 1
-                     - 2 * N * log(AOM);
+      double part2 = context.negativeLogLikelihood() + 1 - 2 * N * log(AOM);
       double fval = part1 + part2;
       assert(!boost::math::isnan(fval));
       return fval;
     }
 };
 
-class MMLObjectiveFunction
+class MMLObjectiveGradientScale
 {
   private:
-    Vector sample_mean;
+    long double N;
 
-    Matrix S;
+    long double C1,C2;
+
+    mutable Kent kent;
+
+  public:
+    MMLObjectiveGradientScale(
+      double alpha, double eta, double psi, double delta, 
+      Vector &sample_mean, Matrix &S, long double sample_size
+    ) : N(sample_size)
+    {
+      kent.setParameters(alpha,eta,psi,delta,1,0);
+      Vector m0 = kent.Mean();
+      Vector m1 = kent.MajorAxis();
+      Vector m2 = kent.MinorAxis();
+      C1 = computeDotProduct(sample_mean,m0);
+      C2 = prod_xMy(m1,S,m1) - prod_xMy(m2,S,m2);
+    }
+
+    /*!
+     *  gradient: - d(log h) + 0.5 d(log det(fisher)) + N (c_k/c, c_b/c) 
+     *            - (m0' x, mj' xx' mj - mi xx' mi)
+     */
+    column_vector operator() (const column_vector& x) const {
+      double k = x(0);
+      double b = x(1);
+
+      kent.setScale(k,b);
+      Vector dlog_prior = kent.computeGradientLogPriorScale();
+      Vector dlog_fisher = kent.computeGradientLogFisherScale();
+      Vector dlog_norm = kent.computeGradientLogNormalizationConstant();
+      column_vector gradient(2);
+      gradient(0) = -dlog_prior[0] + 0.5 * dlog_fisher[0] + N * dlog_norm[0] - C1;
+      gradient(1) = -dlog_prior[1] + 0.5 * dlog_fisher[1] + N * dlog_norm[1] - C2;
+      return gradient;
+    }
+};
+
+class MMLObjectiveFunction
+{
+  private:
+    mutable EvaluationContext context;
 
-    int N;
+    long double N;
 
     double alpha_init,eta_init,psi_init,delta_init;
 
@@ -260,8 +812,8 @@ class MMLObjectiveFunction
 
   public:
     MMLObjectiveFunction(
-      Vector &sample_mean, Matrix &S, int sample_size, column_vector &sp
-    ) : sample_mean(sample_mean), S(S), N(sample_size)
+      Vector &sample_mean, Matrix &S, long double sample_size, column_vector &sp
+    ) : context(sample_mean,S,sample_size), N(sample_size)
     {
       alpha_init = sp(0);
       eta_init = sp(1);
@@ -286,22 +838,16 @@ class MMLObjectiveFunction
       double k = x(3);
       double b = x(4);
 
-      Vector m0(3,0),m1(3,0),m2,spherical(3,0);
-      spherical[0] = 1;
-      // compute m0
-      spherical[1] = alpha; spherical[2] = eta;
-      spherical2cartesian(spherical,m0);
-      // compute m1
+      // m0: (alpha,eta); m1: (psi,delta); m2: m0 X m1
       // cos(delta-eta) = -cot(alpha) cot(psi)
+      // (no major axis for these angles: fall back to the initial ones)
       double tmp = -1/(tan(alpha) * tan(psi));
       double delta;
-      if (fabs(tmp)-1 < TOLERANCE) {
-        cout << "here\n";
+      if (fabs(fabs(tmp)-1) < TOLERANCE) {
         if (tmp < 0) tmp = -1;
         else if (tmp > 0) tmp = 1;
       }
       if (fabs(tmp) > 1) {
-        cout << "yes, tmp: " << tmp << endl;;
         alpha = alpha_init;
         eta = eta_init;
         psi = psi_init;
@@ -310,36 +856,173 @@ class MMLObjectiveFunction
         double acos_tmp = acos(tmp);
         delta = eta + acos_tmp;
         if (!(delta >= eta && delta <= PI+eta)) {
-          cout << "yes2\n";
           delta = eta - acos_tmp;
           assert(delta >= eta && delta <= PI+eta);
         }
       }
-      spherical[1] = psi;
-      spherical[2] = delta;
-      spherical2cartesian(spherical,m1);
-      // compute m2: m0 X m1
-      m2 = crossProduct(m0,m1);
 
-      Kent kent(alpha,eta,psi,delta,k,b);
+      Kent &kent = context.set(alpha,eta,psi,delta,k,b);
       long double log_prior = kent.computeLogPriorProbability();
       long double log_fisher = kent.computeLogFisherInformation(N);
-      Vector sample_mean1 = sample_mean; Matrix S1 = S;
       double part1 = 2.5 * log(kd) - log_prior + 0.5 * log_fisher;
-      double part2 = kent.computeNegativeLogLikelihood(sample_mean1,S1,N) + 2.5
-                     - 2 * N * log(AOM);
+      double part2 = context.negativeLogLikelihood() + 2.5 - 2 * N * log(AOM);
       double fval = part1 + part2;
       assert(!boost::math::isnan(fval));
       return fval;
     }
 };
 
+/*!
+ *  Exact gradient of MMLObjectiveFunction
+ */
+class MMLGradient
+{
+  private:
+    const Vector &sample_mean;
+
+    const Matrix &S;
+
+    long double N;
+
+    double init[4];
+
+    mutable DualKent kent;
+
+  public:
+    MMLGradient(
+      Vector &sample_mean, Matrix &S, long double sample_size, column_vector &sp
+    ) : sample_mean(sample_mean), S(S), N(sample_size)
+    {
+      init[0] = sp(0);
+      init[1] = sp(1);
+      init[2] = sp(2);
+      double tmp = -1/(tan(init[0]) * tan(init[2]));
+      init[3] = init[1] + acos(tmp);
+    }
+
+    column_vector operator() (const column_vector& x) const {
+      KentDual angles[4];
+      computeDualAngles(x,init,angles);
+      KentDual k = KentDual::variable(x(3),3);
+      KentDual b = KentDual::variable(x(4),4);
+      kent.setParameters(angles[0],angles[1],angles[2],angles[3],k,b);
+      return gradientOf(kent.messageLength(sample_mean,S,N));
+    }
+};
+
+// MML: x = (w,k,t) with 2b/k = 1/(1+exp(-t))
+class MMLObjectiveFunctionRotation
+{
+  private:
+    mutable EvaluationContext context;
+
+    mutable LocalRotation frame;
+
+    long double N;
+
+    double kd;
+
+  public:
+    MMLObjectiveFunctionRotation(
+      Vector &m0, Vector &m1, Vector &sample_mean, Matrix &S, long double sample_size
+    ) : context(sample_mean,S,sample_size), frame(m0,m1), N(sample_size)
+    {
+      kd = 1;
+    }
+
+    /*!
+     *  \brief k,b from (k,t): for k > 0 every t is in the support of the
+     *  prior (0 < 2b < k), where the moments needed by the Fisher 
+     *  information are defined. 2b/k is kept MIN_ECCENTRICITY away from 
+     *  0 and 1 where the orientation is not identified.
+     */
+    static void getScale(double x3, double x4, double &k, double &b) {
+      k = x3;
+      double e = MIN_ECCENTRICITY + (1 - 2 * MIN_ECCENTRICITY) / (1 + exp(-x4));
+      b = 0.5 * k * e;
+    }
+
+    static void setScale(double k, double b, double &x3, double &x4) {
+      double e = 2 * b / k;
+      if (e < 2 * MIN_ECCENTRICITY) e = 2 * MIN_ECCENTRICITY;
+      else if (e > 1 - 2 * MIN_ECCENTRICITY) e = 1 - 2 * MIN_ECCENTRICITY;
+      double u = (e - MIN_ECCENTRICITY) / (1 - 2 * MIN_ECCENTRICITY);
+      x3 = k;
+      x4 = log(u / (1 - u));
+    }
+
+    /*!
+     *  minimize function: as MMLObjectiveFunction. The prior and the 
+     *  Fisher information are evaluated at the angles of the rotated frame;
+     *  h / sqrt(det(fisher)) does not depend on the parameterization.
+     */
+    double operator() (const column_vector& x) const {
+      double k,b;
+      getScale(x(3),x(4),k,b);
+      if (k <= 0) {
+        return std::numeric_limits<double>::max();
+      }
+      frame.rotate(x(0),x(1),x(2));
+      Kent &kent = context.setAxes(frame.Mean(),frame.MajorAxis(),k,b);
+      long double log_prior = kent.computeLogPriorProbability();
+      long double log_fisher = kent.computeLogFisherInformation(N);
+      if (boost::math::isnan(log_fisher)) {
+        // degenerate (k -> 0): the line search has to back off
+        return std::numeric_limits<double>::max();
+      }
+      double part1 = 2.5 * log(kd) - log_prior + 0.5 * log_fisher;
+      double part2 = context.negativeLogLikelihood() + 2.5 - 2 * N * log(AOM);
+      double fval = part1 + part2;
+      assert(!boost::math::isnan(fval));
+      return fval;
+    }
+};
+
+/*!
+ *  Exact gradient of MMLObjectiveFunctionRotation (zero where the 
+ *  objective is infeasible)
+ */
+class MMLGradientRotation
+{
+  private:
+    Vector m0,m1;
+
+    const Vector &sample_mean;
+
+    const Matrix &S;
+
+    long double N;
+
+    mutable DualKent kent;
+
+  public:
+    MMLGradientRotation(
+      Vector &m0, Vector &m1, Vector &sample_mean, Matrix &S, long double sample_size
+    ) : m0(m0), m1(m1), sample_mean(sample_mean), S(S), N(sample_size)
+    {}
+
+    column_vector operator() (const column_vector& x) const {
+      // MMLObjectiveFunctionRotation::getScale()
+      KentDual k = KentDual::variable(x(3),3);
+      KentDual t = KentDual::variable(x(4),4);
+      KentDual e = MIN_ECCENTRICITY + (1 - 2 * MIN_ECCENTRICITY) / (1 + exp(-t));
+      KentDual b = 0.5 * k * e;
+      if (k <= 0) {
+        return gradientOf(KentDual(0));
+      }
+      KentDual mean[3],major[3];
+      computeDualFrame(m0,m1,x,k,b,mean,major);
+      kent.setAxes(mean,major,k,b);
+      return gradientOf(kent.messageLength(sample_mean,S,N));
+    }
+};
+
 class Optimize
 {
   private:
     int estimation;
 
-    int N;
+    long double N;
 
     Vector mean,major,minor; 
 
@@ -349,16 +1032,38 @@ class Optimize
 
     double c1,c2;
 
+    int parameterization;
+
+    struct OptimizeResult result;     // of the last minimization
+
+    struct OptimizeSummary summary;
+
+    std::atomic<double> *shared_best;  // of a multi-start search (or NULL)
+
+    void addToSummary(struct OptimizeResult &);
+
   public:
     Optimize(string);
 
-    void initialize(int, Vector &, Vector &, Vector &, long double, long double);
+    void setParameterization(int);
+
+    void initialize(long double, Vector &, Vector &, Vector &, long double, long double);
 
     void computeEstimates(Vector &, Matrix &, struct Estimates &);
 
+    void computeEstimatesMultiStart(Vector &, Matrix &, struct Estimates &, int, int);
+
     void finalize(column_vector &, struct Estimates &);
 
-    column_vector minimize(Vector &, Matrix &, int);
+    void finalizeRotation(column_vector &, struct Estimates &);
+
+    struct OptimizeResult minimize(Vector &, Matrix &, int);
+
+    struct OptimizeResult getResult();
+
+    struct OptimizeSummary getSummary();
+
+    void printSummary(ostream &);
 };
 
 #endif
@@ -0,0 +1,245 @@
+#include "SampleFile.h"
+#include "Support.h"
+#include "SampleWriter.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+/*!
+ *  \brief Fills in the header of a binary sample file.
+ *  \param header a reference to a SampleFileHeader
+ *  \param count the number of rows
+ *  \param dimension the number of values in a row
+ *  \param precision bytes per value (4, 8 or 16)
+ */
+void initializeHeader(
+  struct SampleFileHeader &header,
+  uint64_t count,
+  int dimension,
+  int precision
+) {
+  memset(&header,0,sizeof(header));
+  memcpy(header.magic,SAMPLE_FILE_MAGIC,8);
+  header.version = SAMPLE_FILE_VERSION;
+  header.byte_order = SAMPLE_FILE_BYTE_ORDER;
+  header.count = count;
+  header.dimension = dimension;
+  header.precision = precision;
+}
+
+/*!
+ *  \brief Checks that a header is readable on this machine and is
+ *  consistent with the size of the file.
+ *  \param header a reference to a const SampleFileHeader
+ *  \param file_size size of the file in bytes
+ *  \return true if the header is valid
+ */
+bool validateHeader(const struct SampleFileHeader &header, uint64_t file_size)
+{
+  if (memcmp(header.magic,SAMPLE_FILE_MAGIC,8) != 0) {
+    cout << "Error: not a binary sample file ...\n";
+    return false;
+  }
+  if (header.version != SAMPLE_FILE_VERSION) {
+    cout << "Error: unsupported sample file version: " << header.version << endl;
+    return false;
+  }
+  if (header.byte_order != SAMPLE_FILE_BYTE_ORDER) {
+    cout << "Error: sample file was written with a different byte order ...\n";
+    return false;
+  }
+  if (!(header.precision == SINGLE_PRECISION ||
+        header.precision == DOUBLE_PRECISION ||
+        (header.precision == EXTENDED_PRECISION &&
+         sizeof(long double) == EXTENDED_PRECISION))) {
+    cout << "Error: unsupported precision: " << header.precision << endl;
+    return false;
+  }
+  uint64_t expected = sizeof(struct SampleFileHeader)
+                      + header.count * header.dimension * header.precision;
+  if (header.dimension == 0 || file_size < expected) {
+    cout << "Error: sample file is truncated: " << file_size
+         << " bytes (expected " << expected << ") ...\n";
+    return false;
+  }
+  return true;
+}
+
+/*!
+ *  \brief Writes a sample in the binary sample file format.
+ *  \param file_name a pointer to a const char
+ *  \param sample a reference to a std::vector<Vector>
+ *  \param precision bytes per value (4, 8 or 16)
+ */
+void writeSampleFile(const char *file_name, std::vector<Vector > &sample, int precision)
+{
+  int D = sample.size() ? sample[0].size() : 3;
+  string name = file_name;
+  SampleWriter writer(name,BINARY_OUTPUT,D,precision,false);
+  writer.write(sample);
+  writer.close();
+}
+
+/*!
+ *  Null constructor
+ */
+MappedSample::MappedSample() : fd(-1), map(NULL), map_size(0),
+                               header(NULL), values(NULL)
+{}
+
+/*!
+ *  Constructor: maps the file
+ */
+MappedSample::MappedSample(string &file_name) : fd(-1), map(NULL), map_size(0),
+                                                header(NULL), values(NULL)
+{
+  open(file_name);
+}
+
+MappedSample::~MappedSample()
+{
+  close();
+}
+
+/*!
+ *  \brief Maps a binary sample file into memory. Pages are brought in
+ *  by the kernel on first access; the kernel is told the access is
+ *  sequential so that it reads ahead.
+ *  \param file_name a reference to a string
+ *  \return true if the file was mapped
+ */
+bool MappedSample::open(string &file_name)
+{
+  close();
+  fd = ::open(file_name.c_str(),O_RDONLY);
+  if (fd < 0) {
+    cout << "Error: unable to open " << file_name << endl;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd,&st) != 0 || st.st_size < (off_t) sizeof(struct SampleFileHeader)) {
+    cout << "Error: " << file_name << " is not a binary sample file ...\n";
+    close();
+    return false;
+  }
+  map_size = st.st_size;
+  map = mmap(NULL,map_size,PROT_READ,MAP_SHARED,fd,0);
+  if (map == MAP_FAILED) {
+    cout << "Error: mmap failed for " << file_name << endl;
+    map = NULL;
+    close();
+    return false;
+  }
+  madvise(map,map_size,MADV_SEQUENTIAL);
+  header = static_cast<const struct SampleFileHeader *>(map);
+  if (!validateHeader(*header,map_size)) {
+    close();
+    return false;
+  }
+  values = static_cast<const char *>(map) + sizeof(struct SampleFileHeader);
+  return true;
+}
+
+void MappedSample::close()
+{
+  if (map != NULL) {
+    munmap(map,map_size);
+  }
+  if (fd >= 0) {
+    ::close(fd);
+  }
+  fd = -1;
+  map = NULL;
+  map_size = 0;
+  header = NULL;
+  values = NULL;
+}
+
+bool MappedSample::isOpen() const
+{
+  return values != NULL;
+}
+
+uint64_t MappedSample::size() const
+{
+  return header ? header->count : 0;
+}
+
+int MappedSample::dimension() const
+{
+  return header ? header->dimension : 0;
+}
+
+int MappedSample::precision() const
+{
+  return header ? header->precision : 0;
+}
+
+/*!
+ *  \brief Pointer to the first value (row-major, precision() bytes each)
+ */
+const void *MappedSample::data() const
+{
+  return values;
+}
+
+/*!
+ *  \brief Value j of row i converted to long double
+ */
+long double MappedSample::get(uint64_t i, int j) const
+{
+  switch(header->precision) {
+    case SINGLE_PRECISION:
+      return row<float>(i)[j];
+
+    case DOUBLE_PRECISION:
+      return row<double>(i)[j];
+
+    default:
+      return row<long double>(i)[j];
+  }
+}
+
+/*!
+ *  \brief Copies row i into x (x must have dimension() elements)
+ */
+void MappedSample::getRow(uint64_t i, Vector &x) const
+{
+  for (int j=0; j<header->dimension; j++) {
+    x[j] = get(i,j);
+  }
+}
+
+/*!
+ *  \brief Tells the kernel that rows [first,last) will not be read again,
+ *  so their pages are dropped from the resident set. Streaming over a
+ *  file this way keeps the memory footprint constant.
+ */
+void MappedSample::release(uint64_t first, uint64_t last) const
+{
+  long page = sysconf(_SC_PAGESIZE);
+  size_t row_size = (size_t) header->dimension * header->precision;
+  size_t begin = sizeof(struct SampleFileHeader) + first * row_size;
+  size_t end = sizeof(struct SampleFileHeader) + last * row_size;
+  begin = (begin / page) * page;
+  end = (end / page) * page;  // keep the page holding the next row
+  if (end > begin) {
+    madvise(static_cast<char *>(map) + begin,end - begin,MADV_DONTNEED);
+  }
+}
+
+/*!
+ *  \brief Copies the whole file into the std::vector<Vector>
+ *  representation used by the estimators.
+ */
+std::vector<Vector> MappedSample::toVectors() const
+{
+  std::vector<Vector> sample(size(),Vector(dimension(),0));
+  for (uint64_t i=0; i<size(); i++) {
+    getRow(i,sample[i]);
+  }
+  return sample;
+}
+
@@ -0,0 +1,95 @@
+#ifndef SAMPLE_FILE_H
+#define SAMPLE_FILE_H
+
+#include "Header.h"
+#include <stdint.h>
+
+#define SAMPLE_FILE_MAGIC "FBSAMPLE"
+#define SAMPLE_FILE_VERSION 1
+#define SAMPLE_FILE_BYTE_ORDER 0x01020304
+
+// precision: size in bytes of one stored value
+#define SINGLE_PRECISION 4
+#define DOUBLE_PRECISION 8
+#define EXTENDED_PRECISION 16
+
+/*!
+ *  Binary sample file: a 64 byte header followed by count X dimension
+ *  values stored row-major in native byte order. The header size keeps
+ *  the data aligned for every precision.
+ */
+struct SampleFileHeader
+{
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t count;
+  uint32_t dimension;
+  uint32_t precision;
+  uint32_t reserved[8];
+};
+
+void initializeHeader(struct SampleFileHeader &, uint64_t, int, int);
+bool validateHeader(const struct SampleFileHeader &, uint64_t);
+void writeSampleFile(const char *, std::vector<Vector > &, int);
+
+/*!
+ *  Read-only, zero-copy view of a binary sample file through mmap().
+ *  Rows are handed out as pointers into the mapping; nothing is parsed
+ *  or copied until a caller asks for a Vector.
+ */
+class MappedSample
+{
+  private:
+    int fd;
+
+    void *map;
+
+    size_t map_size;
+
+    const struct SampleFileHeader *header;
+
+    const char *values;
+
+    MappedSample(const MappedSample &);
+
+    MappedSample &operator=(const MappedSample &);
+
+  public:
+    MappedSample();
+
+    MappedSample(string &);
+
+    ~MappedSample();
+
+    bool open(string &);
+
+    void close();
+
+    bool isOpen() const;
+
+    uint64_t size() const;
+
+    int dimension() const;
+
+    int precision() const;
+
+    const void *data() const;
+
+    template <typename T>
+    const T *row(uint64_t i) const {
+      assert(sizeof(T) == header->precision);
+      return reinterpret_cast<const T *>(values) + i * header->dimension;
+    }
+
+    long double get(uint64_t, int) const;
+
+    void getRow(uint64_t, Vector &) const;
+
+    void release(uint64_t, uint64_t) const;
+
+    std::vector<Vector> toVectors() const;
+};
+
+#endif
+
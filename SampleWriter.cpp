@@ -0,0 +1,212 @@
+#include "SampleWriter.h"
+
+#include <charconv>
+
+/*!
+ *  Constructor
+ *  \param file_name a reference to a string
+ *  \param mode BINARY_OUTPUT or TEXT_OUTPUT
+ *  \param D dimensionality of the rows
+ *  \param precision bytes per value (binary) or decimal digits (text)
+ *  \param asynchronous write full buffers on a background thread
+ */
+SampleWriter::SampleWriter(
+  string &file_name, int mode, int D, int precision, bool asynchronous
+) : file_name(file_name), mode(mode), D(D), precision(precision), width(0),
+    count(0), used(0), asynchronous(asynchronous), done(false)
+{
+  fp = fopen(file_name.c_str(),"wb");
+  if (fp == NULL) {
+    cout << "Error: unable to write " << file_name << endl;
+    return;
+  }
+  setvbuf(fp,NULL,_IONBF,0);
+  buffer.resize(WRITE_BUFFER_SIZE);
+  if (mode == BINARY_OUTPUT) {
+    // the row count is patched in by close()
+    struct SampleFileHeader header;
+    initializeHeader(header,0,D,precision);
+    fwrite(&header,sizeof(header),1,fp);
+  }
+  if (asynchronous) {
+    worker = std::thread(&SampleWriter::run,this);
+  }
+}
+
+/*!
+ *  Constructor for text output with fixed width columns (as writeToFile)
+ */
+SampleWriter::SampleWriter(
+  string &file_name, int mode, int D, int precision, bool asynchronous, int width
+) : SampleWriter(file_name,mode,D,precision,asynchronous)
+{
+  this->width = width;
+}
+
+SampleWriter::~SampleWriter()
+{
+  close();
+}
+
+bool SampleWriter::isOpen()
+{
+  return fp != NULL;
+}
+
+/*!
+ *  \brief Number of rows written so far
+ */
+uint64_t SampleWriter::size()
+{
+  return count;
+}
+
+/*!
+ *  \brief Makes sure n more bytes fit in the current buffer.
+ */
+void SampleWriter::reserve(size_t n)
+{
+  if (used + n > buffer.size()) {
+    flushBuffer();
+    if (n > buffer.size()) buffer.resize(n);
+  }
+}
+
+/*!
+ *  \brief Hands the current buffer to the file (or to the background
+ *  thread, waiting while MAX_QUEUED_BUFFERS are still pending).
+ */
+void SampleWriter::flushBuffer()
+{
+  if (used == 0) return;
+  if (!asynchronous) {
+    fwrite(&buffer[0],1,used,fp);
+    used = 0;
+    return;
+  }
+  std::unique_lock<std::mutex> guard(lock);
+  cv.wait(guard,[this]{ return queue.size() < MAX_QUEUED_BUFFERS; });
+  buffer.resize(used);
+  queue.push_back(std::vector<char>());
+  queue.back().swap(buffer);
+  if (free_buffers.size()) {
+    buffer.swap(free_buffers.front());
+    free_buffers.pop_front();
+  }
+  guard.unlock();
+  cv.notify_all();
+  buffer.resize(WRITE_BUFFER_SIZE);
+  used = 0;
+}
+
+/*!
+ *  \brief Background thread: writes queued buffers in order.
+ */
+void SampleWriter::run()
+{
+  std::unique_lock<std::mutex> guard(lock);
+  while (1) {
+    cv.wait(guard,[this]{ return done || queue.size(); });
+    if (queue.empty()) break;  // done and drained
+    std::vector<char> current;
+    current.swap(queue.front());
+    queue.pop_front();
+    guard.unlock();
+    cv.notify_all();
+    fwrite(&current[0],1,current.size(),fp);
+    guard.lock();
+    free_buffers.push_back(std::vector<char>());
+    free_buffers.back().swap(current);
+  }
+}
+
+void SampleWriter::write(Vector &x)
+{
+  write(&x[0],1);
+}
+
+void SampleWriter::write(std::vector<Vector> &sample)
+{
+  for (int i=0; i<sample.size(); i++) {
+    write(&sample[i][0],1);
+  }
+}
+
+/*!
+ *  \brief Appends rows stored contiguously (row-major, D values each).
+ *  \param x a pointer to the first value
+ *  \param rows the number of rows
+ */
+void SampleWriter::write(const long double *x, long rows)
+{
+  if (fp == NULL) return;
+  if (mode == BINARY_OUTPUT) {
+    size_t row_size = D * precision;
+    for (long i=0; i<rows; i++, x+=D) {
+      reserve(row_size);
+      char *out = &buffer[used];
+      for (int j=0; j<D; j++) {
+        if (precision == SINGLE_PRECISION) {
+          float value = x[j];
+          memcpy(out+j*sizeof(float),&value,sizeof(float));
+        } else if (precision == DOUBLE_PRECISION) {
+          double value = x[j];
+          memcpy(out+j*sizeof(double),&value,sizeof(double));
+        } else {
+          memcpy(out+j*sizeof(long double),&x[j],sizeof(long double));
+        }
+      }
+      used += row_size;
+    }
+  } else {
+    for (long i=0; i<rows; i++, x+=D) {
+      for (int j=0; j<D; j++) {
+        char field[512];
+        std::to_chars_result result = std::to_chars(
+          field,field+sizeof(field),(double) x[j],std::chars_format::fixed,precision
+        );
+        int length = result.ptr - field;
+        reserve(length + width + 2);
+        char *out = &buffer[used];
+        if (width == 0 && j > 0) {
+          *out++ = ' ';
+        }
+        for (int k=length; k<width; k++) {
+          *out++ = ' ';
+        }
+        memcpy(out,field,length);
+        out += length;
+        used = out - &buffer[0];
+      }
+      buffer[used++] = '\n';
+    }
+  }
+  count += rows;
+}
+
+/*!
+ *  \brief Flushes all pending rows, stops the background thread and, for
+ *  binary output, records the final row count in the header.
+ */
+void SampleWriter::close()
+{
+  if (fp == NULL) return;
+  flushBuffer();
+  if (asynchronous) {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      done = true;
+    }
+    cv.notify_all();
+    worker.join();
+  }
+  if (mode == BINARY_OUTPUT) {
+    struct SampleFileHeader header;
+    initializeHeader(header,count,D,precision);
+    fseek(fp,0,SEEK_SET);
+    fwrite(&header,sizeof(header),1,fp);
+  }
+  fclose(fp);
+  fp = NULL;
+}
+
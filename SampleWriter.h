@@ -0,0 +1,89 @@
+#ifndef SAMPLE_WRITER_H
+#define SAMPLE_WRITER_H
+
+#include "Header.h"
+#include "SampleFile.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+
+#define BINARY_OUTPUT 0
+#define TEXT_OUTPUT 1
+
+#define WRITE_BUFFER_SIZE (4 << 20)
+#define MAX_QUEUED_BUFFERS 4
+
+/*!
+ *  Buffered writer for samples of vectors. Rows are formatted into large
+ *  buffers (raw values for BINARY_OUTPUT, std::to_chars for TEXT_OUTPUT)
+ *  and handed to the file in one fwrite per buffer. In asynchronous mode
+ *  full buffers are written by a background thread, so formatting and
+ *  generation of the next rows overlap with the disk.
+ */
+class SampleWriter
+{
+  private:
+    FILE *fp;
+
+    string file_name;
+
+    int mode;
+
+    int D;
+
+    int precision;  // bytes per value (binary) or decimal digits (text)
+
+    int width;      // minimum field width of a text value (0: compact)
+
+    uint64_t count;
+
+    std::vector<char> buffer;
+
+    size_t used;
+
+    bool asynchronous;
+
+    std::thread worker;
+
+    std::mutex lock;
+
+    std::condition_variable cv;
+
+    std::deque<std::vector<char> > queue,free_buffers;
+
+    bool done;
+
+    void reserve(size_t);
+
+    void flushBuffer();
+
+    void run();
+
+    SampleWriter(const SampleWriter &);
+
+    SampleWriter &operator=(const SampleWriter &);
+
+  public:
+    SampleWriter(string &, int, int, int, bool);
+
+    SampleWriter(string &, int, int, int, bool, int);
+
+    ~SampleWriter();
+
+    bool isOpen();
+
+    void write(Vector &);
+
+    void write(std::vector<Vector> &);
+
+    void write(const long double *, long);
+
+    uint64_t size();
+
+    void close();
+};
+
+#endif
+
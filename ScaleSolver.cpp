@@ -0,0 +1,165 @@
+#include "ScaleSolver.h"
+#include "Optimize.h"
+
+/*!
+ *  Constructor
+ *  \param estimation MOMENT or MML_SCALE
+ *  \param m0 the mean direction
+ *  \param m1 the major axis
+ *  \param m2 the minor axis
+ *  \param sample_mean a reference to a Vector (\sum x)
+ *  \param S a reference to a Matrix (\sum x x')
+ *  \param sample_size the sample size
+ */
+ScaleSolver::ScaleSolver(
+  int estimation, Vector &m0, Vector &m1, Vector &m2,
+  Vector &sample_mean, Matrix &S, long double sample_size
+) : estimation(estimation), N(sample_size)
+{
+  assert(estimation == MOMENT || estimation == MML_SCALE);
+  C1 = computeDotProduct(sample_mean,m0);
+  C2 = prod_xMy(m1,S,m1) - prod_xMy(m2,S,m2);
+}
+
+/*!
+ *  \brief The objective at (k,b) and, if gradient is not NULL, its 
+ *  gradient and Hessian.
+ *  MOMENT: log c(k,b) - k (m0' x)/N - b (mj' xx' mj - mi' xx' mi)/N, whose
+ *  Hessian is the Fisher matrix of (k,b) per point.
+ *  MML_SCALE: as MMLObjectiveFunctionScale; the Hessian is N times the
+ *  Fisher matrix plus the curvature of the prior. The curvature of 
+ *  0.5 log det(fisher), O(1) against O(N), is left out, which keeps the
+ *  Hessian positive definite.
+ */
+long double ScaleSolver::evaluate(
+  long double k, long double b, long double *gradient, long double hessian[2][2]
+) {
+  long double r[MAX_SCALE_ORDER+1][MAX_SCALE_ORDER+1];
+  int order;
+  if (estimation == MOMENT) {
+    order = (gradient == NULL) ? 0 : 2;
+  } else {
+    order = (gradient == NULL) ? 2 : 3;
+  }
+  kent.setScale(k,b);
+  long double log_c = kent.computeLogScaleSeries(order,r);
+
+  if (estimation == MOMENT) {
+    long double fval = log_c - (k * C1 + b * C2) / N;
+    if (gradient != NULL) {
+      gradient[0] = r[0][1] - C1 / N;
+      gradient[1] = r[1][0] - C2 / N;
+      hessian[0][0] = r[0][2] + r[0][1]/k - r[0][1] * r[0][1];
+      hessian[1][1] = r[2][0] - r[1][0] * r[1][0];
+      hessian[0][1] = hessian[1][0] = r[1][1] - r[0][1] * r[1][0];
+    }
+    return fval;
+  }
+
+  long double dlog_fisher[2];
+  long double log_fisher = kent.computeLogFisherScale(r,gradient ? dlog_fisher : NULL);
+  long double log_prior = kent.computeLogPriorScale();
+  long double part1 = log(0.08019) - log_prior + 0.5 * (log_fisher + 2 * log(N));
+  long double part2 = N * log_c - k * C1 - b * C2 + 1 - 2 * N * log(AOM);
+  if (gradient != NULL) {
+    long double k2 = k * k;
+    gradient[0] = -(2/k - 4*k/(1+k2)) + 0.5 * dlog_fisher[0] + N * r[0][1] - C1;
+    gradient[1] = 0.5 * dlog_fisher[1] + N * r[1][0] - C2;
+    hessian[0][0] = N * (r[0][2] + r[0][1]/k - r[0][1] * r[0][1])
+                    + 2/k2 + 4*(1-k2)/((1+k2)*(1+k2));
+    hessian[1][1] = N * (r[2][0] - r[1][0] * r[1][0]);
+    hessian[0][1] = hessian[1][0] = N * (r[1][1] - r[0][1] * r[1][0]);
+  }
+  return part1 + part2;
+}
+
+/*!
+ *  \brief Minimizes the objective from (k,b). Each iteration takes the
+ *  Newton step (the steepest descent step if the Hessian is not positive
+ *  definite), shortens it to stay inside the box and halves it until the
+ *  objective decreases sufficiently.
+ *  \param k kappa: the starting value on entry, the estimate on return
+ *  \param b beta: the starting value on entry, the estimate on return
+ *  \param result the iterations, evaluations and termination are recorded
+ *  \return the objective at the estimate
+ */
+double ScaleSolver::minimize(long double &k, long double &b, struct OptimizeResult &result)
+{
+  // start inside the box
+  if (!(k > 0)) k = 1;
+  if (!(b >= 0)) b = 0;
+  if (2 * b >= k) b = 0.5 * SCALE_SOLVER_BOUNDARY * k;
+
+  long double gradient[2],hessian[2][2],step[2];
+  long double fval = evaluate(k,b,gradient,hessian);
+  result.objective_evaluations++;
+  result.gradient_evaluations++;
+  result.termination = STOP_MAX_ITERATIONS;
+  while (result.iterations < SCALE_SOLVER_MAX_ITERATIONS) {
+    result.iterations++;
+    long double det = hessian[0][0] * hessian[1][1] - hessian[0][1] * hessian[1][0];
+    if (hessian[0][0] > 0 && det > 0) {
+      step[0] = -(hessian[1][1] * gradient[0] - hessian[0][1] * gradient[1]) / det;
+      step[1] = -(hessian[0][0] * gradient[1] - hessian[1][0] * gradient[0]) / det;
+    } else {
+      step[0] = -gradient[0];
+      step[1] = -gradient[1];
+    }
+    if (b == 0 && step[1] < 0) {
+      step[1] = 0;   // beta = 0 is an active bound
+    }
+
+    // largest fraction of the step that keeps k > 0, b >= 0, k - 2b > 0
+    long double t = 1;
+    if (step[0] < 0) {
+      t = std::min(t,SCALE_SOLVER_BOUNDARY * k / -step[0]);
+    }
+    if (step[1] < 0) {
+      t = std::min(t,b / -step[1]);
+    }
+    long double dgap = step[0] - 2 * step[1];
+    if (dgap < 0) {
+      t = std::min(t,SCALE_SOLVER_BOUNDARY * (k - 2 * b) / -dgap);
+    }
+
+    long double slope = gradient[0] * step[0] + gradient[1] * step[1];
+    long double k_new,b_new,fval_new = fval;
+    long double gradient_new[2],hessian_new[2][2];
+    bool accepted = false;
+    for (int i=0; i<60; i++) {
+      k_new = k + t * step[0];
+      b_new = b + t * step[1];
+      if (b_new < 0) b_new = 0;
+      // a full Newton step is usually accepted: its derivatives are kept
+      fval_new = evaluate(k_new,b_new,gradient_new,hessian_new);
+      result.objective_evaluations++;
+      result.gradient_evaluations++;
+      if (fval_new <= fval + 1e-4 * t * slope) {
+        accepted = true;
+        break;
+      }
+      t *= 0.5;
+    }
+    if (!accepted) {
+      result.termination = STOP_OBJECTIVE_DELTA;
+      break;
+    }
+    long double change = fval - fval_new;
+    k = k_new;
+    b = b_new;
+    fval = fval_new;
+    for (int i=0; i<2; i++) {
+      gradient[i] = gradient_new[i];
+      for (int j=0; j<2; j++) {
+        hessian[i][j] = hessian_new[i][j];
+      }
+    }
+    if (change < SCALE_SOLVER_TOLERANCE) {
+      result.termination = STOP_OBJECTIVE_DELTA;
+      break;
+    }
+  }
+  result.gradient_norm = sqrt(gradient[0] * gradient[0] + gradient[1] * gradient[1]);
+  return fval;
+}
+
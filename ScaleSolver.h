@@ -0,0 +1,42 @@
+#ifndef SCALE_SOLVER_H
+#define SCALE_SOLVER_H
+
+#include "Header.h"
+#include "Support.h"
+#include "Kent.h"
+
+#define SCALE_SOLVER_MAX_ITERATIONS 100
+#define SCALE_SOLVER_TOLERANCE 1e-10  // stop when the objective changes less
+#define SCALE_SOLVER_BOUNDARY 0.99    // fraction of the step to the boundary
+
+struct OptimizeResult;
+
+/*!
+ *  Minimizes the MOMENT or the MML_SCALE objective over (kappa,beta) with
+ *  the axes held fixed, by damped Newton steps in the box kappa > 0, 
+ *  0 <= 2 beta < kappa. The objective, the gradient and the Hessian come
+ *  from one pass over the normalizer series (Kent::computeLogScaleSeries()),
+ *  the 2x2 Newton system is solved in closed form and a step does no heap
+ *  allocation.
+ */
+class ScaleSolver
+{
+  private:
+    int estimation;     // MOMENT or MML_SCALE
+
+    long double N;
+
+    long double C1,C2;  // m0' x, mj' xx' mj - mi' xx' mi (sums over the sample)
+
+    Kent kent;
+
+    long double evaluate(long double, long double, long double *, long double [2][2]);
+
+  public:
+    ScaleSolver(int, Vector &, Vector &, Vector &, Vector &, Matrix &, long double);
+
+    double minimize(long double &, long double &, struct OptimizeResult &);
+};
+
+#endif
+
@@ -0,0 +1,305 @@
+#include "Statistics.h"
+#include "SampleFile.h"
+#include "TextParser.h"
+#include "Kent.h"
+#include "Optimize.h"
+
+#include <algorithm>
+
+/*!
+ *  \brief Resets the statistics for D-dimensional data.
+ */
+void initializeStatistics(struct SufficientStatistics &stats, int D)
+{
+  stats.sum_x = Vector(D,0);
+  stats.sum_xx = ZeroMatrix(D,D);
+  stats.N = 0;
+}
+
+/*!
+ *  \brief Adds rows stored contiguously (row-major) to the statistics.
+ *  The block is reduced in local accumulators and folded into the
+ *  statistics once.
+ */
+template <typename T>
+static void accumulateRows(
+  struct SufficientStatistics &stats,
+  const T *x,
+  long rows,
+  int D
+) {
+  std::vector<long double> sum(D,0),sum_sq(D*D,0);
+  for (long i=0; i<rows; i++, x+=D) {
+    for (int j=0; j<D; j++) {
+      long double xj = x[j];
+      sum[j] += xj;
+      for (int k=j; k<D; k++) {
+        sum_sq[j*D+k] += xj * x[k];
+      }
+    }
+  }
+  for (int j=0; j<D; j++) {
+    stats.sum_x[j] += sum[j];
+    for (int k=j; k<D; k++) {
+      stats.sum_xx(j,k) += sum_sq[j*D+k];
+      if (k != j) stats.sum_xx(k,j) += sum_sq[j*D+k];
+    }
+  }
+  stats.N += rows;
+}
+
+void accumulateStatistics(
+  struct SufficientStatistics &stats,
+  const long double *x,
+  long rows,
+  int D
+) {
+  accumulateRows(stats,x,rows,D);
+}
+
+void accumulateStatistics(struct SufficientStatistics &stats, std::vector<Vector> &sample)
+{
+  for (int i=0; i<sample.size(); i++) {
+    accumulateRows(stats,&sample[i][0],1,sample[i].size());
+  }
+}
+
+/*!
+ *  \brief Streams a binary sample file through the mapping, dropping
+ *  each block of pages once it has been summed.
+ */
+static bool computeBinaryStatistics(string &file_name, struct SufficientStatistics &stats)
+{
+  MappedSample mapped(file_name);
+  if (!mapped.isOpen()) {
+    return false;
+  }
+  int D = mapped.dimension();
+  initializeStatistics(stats,D);
+  uint64_t block = STATISTICS_BLOCK_SIZE / (D * mapped.precision()) + 1;
+  for (uint64_t first=0; first<mapped.size(); first+=block) {
+    uint64_t last = first + block;
+    if (last > mapped.size()) last = mapped.size();
+    switch(mapped.precision()) {
+      case SINGLE_PRECISION:
+        accumulateRows(stats,mapped.row<float>(first),last-first,D);
+        break;
+
+      case DOUBLE_PRECISION:
+        accumulateRows(stats,mapped.row<double>(first),last-first,D);
+        break;
+
+      case EXTENDED_PRECISION:
+        accumulateRows(stats,mapped.row<long double>(first),last-first,D);
+        break;
+    }
+    mapped.release(first,last);
+  }
+  return true;
+}
+
+/*!
+ *  \brief Reads a text file in fixed-size blocks. Each block is cut at
+ *  its last newline, parsed (in parallel) and summed; the incomplete
+ *  last line is carried over to the next block.
+ */
+static bool computeTextStatistics(string &file_name, struct SufficientStatistics &stats)
+{
+  FILE *fp = fopen(file_name.c_str(),"rb");
+  if (fp == NULL) {
+    cout << "Error: unable to open " << file_name << endl;
+    return false;
+  }
+  TextParser parser;
+  struct TextSample block;
+  block.D = 0;
+  std::vector<char> buffer(STATISTICS_BLOCK_SIZE);
+  size_t carry = 0;
+  long line_offset = 0,num_errors = 0;
+  stats.N = 0;
+  while (1) {
+    size_t requested = buffer.size() - carry;
+    size_t n = fread(&buffer[carry],1,requested,fp);
+    size_t filled = carry + n;
+    bool eof = n < requested;
+    size_t usable = filled;
+    if (!eof) {
+      const char *last = static_cast<const char *>(memrchr(&buffer[0],'\n',filled));
+      if (last == NULL) {  // a line longer than the buffer
+        carry = filled;
+        buffer.resize(2 * buffer.size());
+        continue;
+      }
+      usable = last - &buffer[0] + 1;
+    }
+
+    int D = block.D;
+    parser.parse(&buffer[0],usable,block);
+    if (D == 0 && block.D > 0) {
+      initializeStatistics(stats,block.D);
+    }
+    if (block.N > 0) {
+      accumulateRows(stats,&block.values[0],block.N,block.D);
+    }
+    for (int i=0; i<block.errors.size(); i++, num_errors++) {
+      if (num_errors < MAX_REPORTED_ERRORS) {
+        cout << "Error: " << file_name << ":" << block.errors[i].line + line_offset
+             << ": " << block.errors[i].reason << endl;
+      }
+    }
+    line_offset += std::count(buffer.begin(),buffer.begin()+usable,'\n');
+
+    carry = filled - usable;
+    if (carry) {
+      memmove(&buffer[0],&buffer[usable],carry);
+    }
+    if (eof) break;
+  }
+  fclose(fp);
+  if (num_errors > MAX_REPORTED_ERRORS) {
+    cout << "... " << num_errors - MAX_REPORTED_ERRORS
+         << " more malformed lines in " << file_name << endl;
+  }
+  return true;
+}
+
+/*!
+ *  \brief Computes (\sum x, \sum x x', N) of a sample file without
+ *  loading it: binary sample files are streamed through mmap, text
+ *  files in blocks of STATISTICS_BLOCK_SIZE bytes. Memory use does not
+ *  depend on the size of the file.
+ *  \param file_name a reference to a string
+ *  \param stats a reference to a SufficientStatistics
+ *  \return false if the file could not be read
+ */
+bool computeSufficientStatistics(string &file_name, struct SufficientStatistics &stats)
+{
+  char magic[8];
+  FILE *fp = fopen(file_name.c_str(),"rb");
+  if (fp == NULL) {
+    cout << "Error: unable to open " << file_name << endl;
+    return false;
+  }
+  size_t n = fread(magic,1,8,fp);
+  fclose(fp);
+  if (n == 8 && memcmp(magic,SAMPLE_FILE_MAGIC,8) == 0) {
+    return computeBinaryStatistics(file_name,stats);
+  } else {
+    return computeTextStatistics(file_name,stats);
+  }
+}
+
+/*!
+ *  \brief Fits a Kent distribution to sufficient statistics.
+ *  \param stats a reference to a SufficientStatistics (3D)
+ *  \param type MOMENT, MLE_UNCONSTRAINED, MLE_CONSTRAINED, MML_SCALE or MML
+ *  \return the estimates
+ */
+struct Estimates computeEstimates(struct SufficientStatistics &stats, string type)
+{
+  struct Estimates estimates;
+  Kent kent;
+  if (type.compare("MOMENT") == 0) {
+    estimates = kent.computeMomentEstimates(stats.sum_x,stats.sum_xx,stats.N);
+  } else if (type.compare("MML") == 0) {
+    estimates = kent.computeMMLEstimates(stats.sum_x,stats.sum_xx,stats.N);
+  } else if (type.compare("MML_SCALE") == 0) {
+    estimates = kent.computeMomentEstimates(stats.sum_x,stats.sum_xx,stats.N);
+    Optimize opt(type);
+    opt.initialize(stats.N,estimates.mean,estimates.major_axis,estimates.minor_axis,
+                   estimates.kappa,estimates.beta);
+    opt.computeEstimates(stats.sum_x,stats.sum_xx,estimates);
+  } else {
+    estimates = kent.computeMLEstimates(stats.sum_x,stats.sum_xx,stats.N,type);
+  }
+  return estimates;
+}
+
+/*!
+ *  \brief Whether earlier estimates are close enough to seed a fit: their
+ *  mean and major axis must be within WARM_START_ANGLE of the closed form
+ *  moment axes of the new statistics and (kappa,beta) must be a valid
+ *  start (0 <= 2 beta < kappa).
+ */
+static bool isWarmStart(struct Estimates &previous, struct Estimates &moment)
+{
+  if (previous.mean.size() != 3 || previous.major_axis.size() != 3) {
+    return false;
+  }
+  if (!(previous.kappa > 0 && previous.beta >= 0 && 2 * previous.beta < previous.kappa)) {
+    return false;
+  }
+  long double cos_angle = cos(WARM_START_ANGLE);
+  if (computeDotProduct(previous.mean,moment.mean) < cos_angle) {
+    return false;
+  }
+  // the sign of the major axis is arbitrary
+  if (fabs(computeDotProduct(previous.major_axis,moment.major_axis)) < cos_angle) {
+    return false;
+  }
+  return true;
+}
+
+/*!
+ *  \brief Fits a Kent distribution starting from the estimates of similar 
+ *  data (the same data before a few points were added, or another
+ *  bootstrap resample). When they are close enough (isWarmStart()) the 
+ *  moment estimation that otherwise provides the start is skipped: MOMENT 
+ *  and MML_SCALE take the axes in closed form and only start kappa, beta
+ *  from the previous estimates, the other estimators start all the 
+ *  parameters there. Otherwise this is computeEstimates(stats,type).
+ *  \param stats a reference to a SufficientStatistics (3D)
+ *  \param type MOMENT, MLE_UNCONSTRAINED, MLE_CONSTRAINED, MLE_NEWTON, 
+ *  MML_SCALE or MML
+ *  \param previous a reference to an Estimates
+ *  \return the estimates
+ */
+struct Estimates computeEstimates(
+  struct SufficientStatistics &stats, string type, struct Estimates &previous
+) {
+  Kent kent;
+  struct Estimates estimates = kent.computeAsymptoticMomentEstimates(stats.sum_x,stats.sum_xx,stats.N);
+  if (!isWarmStart(previous,estimates)) {
+    return computeEstimates(stats,type);
+  }
+  if (type.compare("MOMENT") == 0 || type.compare("MML_SCALE") == 0) {
+    Optimize opt("MOMENT");
+    opt.initialize(stats.N,estimates.mean,estimates.major_axis,estimates.minor_axis,
+                   previous.kappa,previous.beta);
+    opt.computeEstimates(stats.sum_x,stats.sum_xx,estimates);
+    if (type.compare("MML_SCALE") == 0) {
+      Optimize opt_scale(type);
+      opt_scale.initialize(stats.N,estimates.mean,estimates.major_axis,estimates.minor_axis,
+                           estimates.kappa,estimates.beta);
+      opt_scale.computeEstimates(stats.sum_x,stats.sum_xx,estimates);
+    }
+  } else {
+    Optimize opt(type);
+    opt.initialize(stats.N,previous.mean,previous.major_axis,previous.minor_axis,
+                   previous.kappa,previous.beta);
+    opt.computeEstimates(stats.sum_x,stats.sum_xx,estimates);
+  }
+  return estimates;
+}
+
+/*!
+ *  \brief Fits a Kent distribution to the data in a file.
+ *  \param file_name a reference to a string
+ *  \param type MOMENT, MLE_UNCONSTRAINED, MLE_CONSTRAINED, MML_SCALE or MML
+ *  \param estimates a reference to an Estimates
+ *  \return false if the file could not be used
+ */
+bool computeEstimatesFromFile(string &file_name, string type, struct Estimates &estimates)
+{
+  struct SufficientStatistics stats;
+  if (!computeSufficientStatistics(file_name,stats)) {
+    return false;
+  }
+  if (stats.N == 0 || stats.sum_x.size() != 3) {
+    cout << "Error: " << file_name << " does not hold a sample of 3D vectors ...\n";
+    return false;
+  }
+  estimates = computeEstimates(stats,type);
+  return true;
+}
+
@@ -0,0 +1,28 @@
+#ifndef STATISTICS_H
+#define STATISTICS_H
+
+#include "Header.h"
+#include "Support.h"
+
+#define STATISTICS_BLOCK_SIZE (4 << 20)
+
+// largest angle (radians) between the axes of earlier estimates and the
+// moment axes of new statistics for the estimates to seed the fit
+#define WARM_START_ANGLE 0.2
+
+void initializeStatistics(struct SufficientStatistics &, int);
+
+void accumulateStatistics(struct SufficientStatistics &, const long double *, long, int);
+
+void accumulateStatistics(struct SufficientStatistics &, std::vector<Vector> &);
+
+bool computeSufficientStatistics(string &, struct SufficientStatistics &);
+
+struct Estimates computeEstimates(struct SufficientStatistics &, string);
+
+struct Estimates computeEstimates(struct SufficientStatistics &, string, struct Estimates &);
+
+bool computeEstimatesFromFile(string &, string, struct Estimates &);
+
+#endif
+
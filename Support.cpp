@@ -1,5 +1,7 @@
 #include "Support.h"
 #include "Test.h"
+#include "TextParser.h"
+#include "SampleWriter.h"
 
 Vector XAXIS,YAXIS,ZAXIS;
 
@@ -72,14 +74,11 @@ bool checkFile(string &file_name)
  */
 void writeToFile(const char *file_name, std::vector<Vector > &v, int precision)
 {
-  ofstream file(file_name);
-  for (int i=0; i<v.size(); i++) {
-    for (int j=0; j<v[i].size(); j++) {
-      file << fixed << setw(10) << setprecision(precision) << v[i][j];
-    }
-    file << endl;
-  }
-  file.close(); 
+  string name = file_name;
+  int D = v.size() ? v[0].size() : 3;
+  SampleWriter writer(name,TEXT_OUTPUT,D,precision,false,10);
+  writer.write(v);
+  writer.close();
 }
 
 /*!
@@ -304,7 +303,7 @@ void spherical2cartesian(Vector &spherical, Vector &cartesian)
  *  \param v2 a reference to a Vector
  *  \return the dot product
  */
-long double computeDotProduct(Vector &v1, Vector &v2) 
+long double computeDotProduct(const Vector &v1, const Vector &v2) 
 {
   assert(v1.size() == v2.size());
   long double dot_product = 0;
@@ -323,6 +322,16 @@ Vector crossProduct(Vector &v1, Vector &v2)
   return ans;
 }
 
+/*!
+ *  \brief Cross product into existing storage (ans must not alias v1, v2)
+ */
+void crossProduct(const Vector &v1, const Vector &v2, Vector &ans) 
+{
+  ans[0] = v1[1] * v2[2] - v1[2] * v2[1];
+  ans[1] = v1[2] * v2[0] - v1[0] * v2[2];
+  ans[2] = v1[0] * v2[1] - v1[1] * v2[0];
+}
+
 /*!
  *  \brief This function computes the surface area of nd-sphere
  *  Surface area = Gamma(d/2+1)/d \pi^(d/2)
@@ -336,9 +345,34 @@ long double computeLogSurfaceAreaSphere(int d)
   return (log_num - log_denom);
 }
 
+/*!
+ *  \brief log I_v(x) by the uniform asymptotic (Debye) expansion in v,
+ *  I_v(v z) ~ exp(v eta) / (sqrt(2 pi v) (1+z^2)^(1/4)) \sum_k u_k(t) / v^k
+ *  with t = 1/sqrt(1+z^2) and eta = sqrt(1+z^2) + log(z/(1+sqrt(1+z^2))).
+ *  Uniform in x > 0; with the terms up to u_4 the relative error is of
+ *  order v^(-5). It does not overflow for large x and costs the same
+ *  for any x (the power series needs about x terms).
+ */
+long double logModifiedBesselFirstKindUniform(long double v, long double x)
+{
+  long double z = x / v;
+  long double s = sqrt(1 + z*z);
+  long double t = 1 / s;
+  long double eta = s + log(z / (1 + s));
+  long double t2 = t*t, t4 = t2*t2, t6 = t4*t2, t8 = t4*t4;
+  long double u1 = t * (3 - 5*t2) / 24;
+  long double u2 = t2 * (81 - 462*t2 + 385*t4) / 1152;
+  long double u3 = t*t2 * (30375 - 369603*t2 + 765765*t4 - 425425*t6) / 414720;
+  long double u4 = t4 * (4465125 - 94121676*t2 + 349922430*t4 - 446185740*t6 
+                         + 185910725*t8) / 39813120;
+  long double sum = 1 + (u1 + (u2 + (u3 + u4/v)/v)/v)/v;
+  return v * eta - 0.5 * log(2*PI*v) - 0.5 * log(s) + log(sum);
+}
+
 /*!
  *  \brief This function computes the log of modified Bessel function value
- *  (used for numerical stability reasons)
+ *  (used for numerical stability reasons): the power series, or the
+ *  uniform expansion for v >= BESSEL_UNIFORM_ORDER.
  */
 long double logModifiedBesselFirstKind(long double alpha, long double x)
 {
@@ -346,6 +380,9 @@ long double logModifiedBesselFirstKind(long double alpha, long double x)
     cout << "Error logModifiedBesselFirstKind: (alpha,x) = (" << alpha << "," << x << ")\n";
     //exit(1);
   }
+  if (alpha >= BESSEL_UNIFORM_ORDER && x > 0) {
+    return logModifiedBesselFirstKindUniform(alpha,x);
+  }
   long double t;
   if (alpha == 0) {
     t = 1;
@@ -390,27 +427,23 @@ void solveQuadratic(
 
 ////////////////////// GEOMETRY FUNCTIONS \\\\\\\\\\\\\\\\\\\\\\\\\\\\
 
+/*!
+ *  \brief Reads a whitespace separated text file of vectors; each row is
+ *  normalized to a unit vector. Malformed lines are reported and skipped.
+ *  \param file_name a reference to a string
+ *  \return the list of unit vectors
+ */
 std::vector<Vector > load_matrix(string &file_name)
 {
-  std::vector<Vector > sample;
-  ifstream file(file_name.c_str());
-  string line;
-  Vector numbers(3,0),unit_vector(3,0);
-  int i;
-  while (getline(file,line)) {
-    boost::char_separator<char> sep(" \t");
-    boost::tokenizer<boost::char_separator<char> > tokens(line,sep);
-    i = 0;
-    BOOST_FOREACH(const string &t, tokens) {
-      istringstream iss(t);
-      long double x;
-      iss >> x;
-      numbers[i++] = x;
-    }
-    normalize(numbers,unit_vector);
-    sample.push_back(unit_vector);
+  TextParser parser;
+  struct TextSample parsed;
+  parser.parse(file_name,parsed);
+
+  std::vector<Vector > sample(parsed.N);
+  for (long i=0; i<parsed.N; i++) {
+    const long double *x = &parsed.values[i*parsed.D];
+    sample[i] = Vector(x,x+parsed.D);
   }
-  file.close();
   return sample;
 }
 
@@ -477,10 +510,18 @@ long double prod_vMv(Vector &v, Matrix &M)
  *  x,y are considered to be a column std::vectors
  *  output: x' M y
  */
-long double prod_xMy(Vector &x, Matrix &M, Vector &y)
-{
-  Vector xM = prod(x,M);
-  return computeDotProduct(xM,y);
+long double prod_xMy(const Vector &x, const Matrix &M, const Vector &y)
+{
+  assert(M.size1() == x.size() && M.size2() == y.size());
+  long double ans = 0;
+  for (int i=0; i<M.size2(); i++) {
+    long double xM_i = 0;
+    for (int j=0; j<M.size1(); j++) {
+      xM_i += x[j] * M(j,i);
+    }
+    ans += xM_i * y[i];
+  }
+  return ans;
 }
 
 /*!
@@ -567,6 +608,38 @@ Matrix computeOrthogonalTransformation(
   return r;
 }
 
+/*!
+ *  \brief Rotation by the angle |w| about w/|w| (Rodrigues' formula):
+ *  R = I + (sin t/t) W + ((1 - cos t)/t^2) W^2, W = [w]x, t = |w|.
+ *  It is smooth in w, including at w = 0.
+ *  \param w a reference to the rotation vector
+ *  \param R a reference to the rotation matrix (3 X 3, filled in place)
+ */
+void computeRotationMatrix(const Vector &w, Matrix &R)
+{
+  if (R.size1() != 3 || R.size2() != 3) R = Matrix(3,3);
+  long double tsq = w[0]*w[0] + w[1]*w[1] + w[2]*w[2];
+  long double a,b;
+  if (tsq < 1e-8) {
+    a = 1 - tsq / 6;
+    b = 0.5 - tsq / 24;
+  } else {
+    long double t = sqrt(tsq);
+    a = sin(t) / t;
+    b = (1 - cos(t)) / tsq;
+  }
+  // W^2 = w w' - |w|^2 I
+  for (int i=0; i<3; i++) {
+    for (int j=0; j<3; j++) {
+      R(i,j) = b * w[i] * w[j];
+    }
+    R(i,i) += 1 - b * tsq;
+  }
+  R(0,1) -= a * w[2]; R(1,0) += a * w[2];
+  R(0,2) += a * w[1]; R(2,0) -= a * w[1];
+  R(1,2) -= a * w[0]; R(2,1) += a * w[0];
+}
+
 Matrix align_xaxis_with_major_axis(Vector &major_axis)
 {
   Vector spherical(3,0);
@@ -846,5 +919,55 @@ void TestFunctions(void)
   //test.fisher();
 
   test.mml_estimation();
+
+  //test.binary_sample_file();
+
+  //test.text_parser();
+
+  //test.sample_writer();
+
+  //test.file_estimation();
+
+  //test.online_estimation();
+
+  //test.gradients();
+
+  //test.newton_estimation();
+
+  //test.allocation_free_evaluation();
+
+  //test.batch_estimation();
+
+  //test.rotation_parameterization();
+
+  //test.optimizer_telemetry();
+
+  //test.multi_start();
+
+  //test.scale_solver();
+
+  //test.warm_start();
+
+  //test.scale_constants();
+
+  //test.fisher_cache();
+
+  //test.differentials_benchmark();
+
+  //test.fisher_grid();
+
+  //test.message_length();
+
+  //test.dual_gradient();
+
+  //test.kent_mixture();
+
+  //test.vmf_mixture();
+
+  //test.mixture_search();
+
+  //test.online_mixture();
+
+  //test.log_density();
 }
 
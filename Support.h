@@ -14,6 +14,14 @@ struct Estimates
   long double kappa,beta;
 };
 
+// everything the estimators need from a sample
+struct SufficientStatistics
+{
+  Vector sum_x;             // \sum x
+  Matrix sum_xx;            // \sum x x'
+  long double N;            // number of observations
+};
+
 // general functions
 struct Parameters parseCommandLineInput (int, char **); 
 void Usage (const char *, options_description &);
@@ -29,10 +37,12 @@ long double norm(Vector &);
 void cartesian2spherical(Vector &, Vector &);
 void cartesian2sphericalPoleXAxis(Vector &, Vector &);
 void spherical2cartesian(Vector &, Vector &);
-long double computeDotProduct(Vector &, Vector &);
+long double computeDotProduct(const Vector &, const Vector &);
 Vector crossProduct(Vector &, Vector &); 
+void crossProduct(const Vector &, const Vector &, Vector &);
 long double computeLogSurfaceAreaSphere(int);
 long double logModifiedBesselFirstKind(long double, long double);
+long double logModifiedBesselFirstKindUniform(long double, long double);
 void solveQuadratic(Vector &, long double, long double, long double);
 
 std::vector<Vector> load_matrix(string &);
@@ -40,13 +50,14 @@ Matrix outer_prod(Vector &, Vector &);
 Vector prod(Matrix &, Vector &);
 Vector prod(Vector &, Matrix &);
 long double prod_vMv(Vector &, Matrix &);
-long double prod_xMy(Vector &, Matrix &, Vector &);
+long double prod_xMy(const Vector &, const Matrix &, const Vector &);
 long double determinant(Matrix &);
 Vector computeVectorSum(std::vector<Vector > &);
 Vector computeNormalizedVectorSum(std::vector<Vector > &);
 Matrix computeDispersionMatrix(std::vector<Vector > &);
 Matrix computeNormalizedDispersionMatrix(std::vector<Vector > &);
 Matrix computeOrthogonalTransformation(Vector &, Vector &);
+void computeRotationMatrix(const Vector &, Matrix &);
 Matrix align_xaxis_with_major_axis(Vector &);
 Matrix align_zaxis_with_vector(Vector &);
 void generateRandomOrthogonalVectors(Vector &, Vector &, Vector &);
@@ -5,9 +5,46 @@
 #include "FB4.h"
 #include "FB6.h"
 #include "Kent.h"
+#include "SampleFile.h"
+#include "TextParser.h"
+#include "SampleWriter.h"
+#include "Statistics.h"
+#include "OnlineEstimator.h"
+#include "BatchEstimator.h"
+#include "WarmStartCache.h"
+#include "FisherGrid.h"
+#include "KentMixture.h"
+#include "vMFMixture.h"
+#include "MixtureSearch.h"
+#include "OnlineKentMixture.h"
+#include "Optimize.h"
+
+#include <atomic>
 
 extern Vector XAXIS,YAXIS,ZAXIS;
 
+// heap allocations are counted while count_allocations is set
+static std::atomic<bool> count_allocations(false);
+static std::atomic<long> num_allocations(0);
+
+void *operator new(size_t size)
+{
+  if (count_allocations) num_allocations++;
+  void *p = malloc(size ? size : 1);
+  if (p == NULL) throw std::bad_alloc();
+  return p;
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+  free(p);
+}
+
 void Test::matrixFunctions()
 {
   cout << "Testing matrices ...\n";
@@ -540,3 +577,1308 @@ void Test::mml_estimation(void)
   kent.computeAllEstimators(random_sample);
 }
 
+
+void Test::binary_sample_file(void)
+{
+  Vector m0,m1,m2;
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(1000);
+
+  string file_name = "./visualize/kent.bin";
+  writeSampleFile(file_name.c_str(),random_sample,DOUBLE_PRECISION);
+  MappedSample mapped(file_name);
+  cout << "count: " << mapped.size() << "; dimension: " << mapped.dimension()
+       << "; precision: " << mapped.precision() << endl;
+
+  long double max_diff = 0;
+  for (int i=0; i<mapped.size(); i++) {
+    const double *x = mapped.row<double>(i);
+    for (int j=0; j<mapped.dimension(); j++) {
+      long double diff = fabs(x[j] - random_sample[i][j]);
+      if (diff > max_diff) max_diff = diff;
+    }
+  }
+  cout << "max |mapped - original|: " << max_diff << endl;
+}
+
+void Test::text_parser(void)
+{
+  Vector m0,m1,m2;
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(100000);
+  string file_name = "./visualize/kent_parser.dat";
+  writeToFile(file_name.c_str(),random_sample,6);
+  ofstream file(file_name.c_str(),ios::app);
+  file << "0.1 0.2\n";            // too few values
+  file << "0.1 abc 0.3\n";        // not a number
+  file << "0 0 0\n";              // cannot be normalized
+  file.close();
+
+  clock_t c_start = clock();
+  TextParser parser;
+  struct TextSample parsed;
+  parser.parse(file_name,parsed);
+  clock_t c_end = clock();
+  cout << "parsed " << parsed.N << " rows (D = " << parsed.D << ") with "
+       << parsed.errors.size() << " malformed lines in "
+       << (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC << " ms (cpu)\n";
+
+  long double max_diff = 0;
+  for (int i=0; i<parsed.N; i++) {
+    for (int j=0; j<parsed.D; j++) {
+      long double diff = fabs(parsed.values[i*parsed.D+j] - random_sample[i][j]);
+      if (diff > max_diff) max_diff = diff;
+    }
+  }
+  cout << "max |parsed - original|: " << max_diff << endl;
+}
+
+void Test::sample_writer(void)
+{
+  Kent kent(100,30);
+  int num_blocks = 10;
+  int block_size = 100000;
+
+  // generation overlapped with writing on the background thread
+  string binary_file = "./visualize/kent_writer.bin";
+  string text_file = "./visualize/kent_writer.dat";
+  SampleWriter binary(binary_file,BINARY_OUTPUT,3,DOUBLE_PRECISION,true);
+  SampleWriter text(text_file,TEXT_OUTPUT,3,6,true);
+  std::vector<Vector> first_block;
+  for (int i=0; i<num_blocks; i++) {
+    std::vector<Vector> block = kent.generateCanonical(block_size);
+    binary.write(block);
+    text.write(block);
+    if (i == 0) first_block = block;
+  }
+  binary.close();
+  text.close();
+
+  MappedSample mapped(binary_file);
+  TextParser parser;
+  struct TextSample parsed;
+  parser.parse(text_file,parsed);
+  cout << "binary rows: " << mapped.size() << "; text rows: " << parsed.N << endl;
+  long double max_diff1 = 0,max_diff2 = 0;
+  for (int i=0; i<block_size; i++) {
+    for (int j=0; j<3; j++) {
+      long double diff1 = fabs(mapped.get(i,j) - first_block[i][j]);
+      long double diff2 = fabs(parsed.values[3*i+j] - first_block[i][j]);
+      if (diff1 > max_diff1) max_diff1 = diff1;
+      if (diff2 > max_diff2) max_diff2 = diff2;
+    }
+  }
+  cout << "max |binary - original|: " << max_diff1 << endl;
+  cout << "max |text - original|: " << max_diff2 << endl;
+}
+
+void Test::file_estimation(void)
+{
+  Vector m0,m1,m2;
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(100000);
+
+  string text_file = "./visualize/kent_stream.dat";
+  string binary_file = "./visualize/kent_stream.bin";
+  writeToFile(text_file.c_str(),random_sample,6);
+  writeSampleFile(binary_file.c_str(),random_sample,DOUBLE_PRECISION);
+
+  string type = "MOMENT";
+  struct Estimates in_memory = kent.computeMomentEstimates(random_sample);
+  print(type,in_memory);
+  struct Estimates from_text,from_binary;
+  computeEstimatesFromFile(text_file,type,from_text);
+  print(type,from_text);
+  computeEstimatesFromFile(binary_file,type,from_binary);
+  print(type,from_binary);
+}
+
+void Test::online_estimation(void)
+{
+  Vector m0,m1,m2;
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(10000);
+
+  string type = "MOMENT";
+  OnlineEstimator decayed(type,EXPONENTIAL_DECAY,0.999);
+  OnlineEstimator windowed(type,SLIDING_WINDOW,2000);
+  for (int i=0; i<random_sample.size(); i++) {
+    decayed.add(random_sample[i]);
+    windowed.add(random_sample[i]);
+    if ((i+1) % 2500 == 0) {
+      clock_t c_start = clock();
+      struct Estimates estimates1 = decayed.refit();
+      struct Estimates estimates2 = windowed.refit();
+      clock_t c_end = clock();
+      cout << "points: " << i+1 << "; N_eff: " << decayed.effectiveSampleSize()
+           << "; refit time: " << (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC << " ms\n";
+      print(type,estimates1);
+      print(type,estimates2);
+    }
+  }
+}
+
+void Test::gradients(void)
+{
+  Vector m0,m1,m2,spherical(3,0);
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(1000);
+  Vector sample_mean = computeVectorSum(random_sample);
+  Matrix S = computeDispersionMatrix(random_sample);
+  long double N = random_sample.size();
+
+  cartesian2spherical(m0,spherical);
+  double alpha = spherical[1], eta = spherical[2];
+  cartesian2spherical(m1,spherical);
+  double psi = spherical[1], delta = spherical[2];
+
+  MomentObjectiveFunction moment(m0,m1,m2,sample_mean,S,N);
+  MomentObjectiveGradient moment_gradient(m0,m1,m2,sample_mean,S,N);
+  MMLObjectiveFunctionScale mml(alpha,eta,psi,delta,sample_mean,S,N);
+  MMLObjectiveGradientScale mml_gradient(alpha,eta,psi,delta,sample_mean,S,N);
+
+  double kb[4][2] = {{10,2},{50,20},{100,30},{400,150}};
+  for (int i=0; i<4; i++) {
+    column_vector x(2);
+    x = kb[i][0],kb[i][1];
+    Kent kent1(kb[i][0],kb[i][1]);
+    cout << "(k,b): (" << kb[i][0] << "," << kb[i][1] << ")\n";
+    cout << "F(0,1) - log_dc_dk: " 
+         << kent1.computeLogDerivativeSeries(0,1) - kent1.log_dc_dk() << endl;
+    cout << "F(0,2) + F(0,1)/k - c_kk: " 
+         << exp(kent1.computeLogDerivativeSeries(0,2) - kent1.log_d2c_dk2())
+            + exp(kent1.computeLogDerivativeSeries(0,1) - kent1.log_d2c_dk2()) / kb[i][0] - 1 
+         << endl;
+    cout << "F(1,1) - log_d2c_dkdb: " 
+         << kent1.computeLogDerivativeSeries(1,1) - kent1.log_d2c_dkdb() << endl;
+    cout << "F(2,0) - log_d2c_db2: " 
+         << kent1.computeLogDerivativeSeries(2,0) - kent1.log_d2c_db2() << endl;
+
+    column_vector numerical = derivative(moment)(x);
+    column_vector exact = moment_gradient(x);
+    cout << "moment gradient: [" << exact(0) << "," << exact(1) << "]; "
+         << "numerical: [" << numerical(0) << "," << numerical(1) << "]\n";
+    numerical = derivative(mml)(x);
+    exact = mml_gradient(x);
+    cout << "mml scale gradient: [" << exact(0) << "," << exact(1) << "]; "
+         << "numerical: [" << numerical(0) << "," << numerical(1) << "]\n";
+  }
+}
+
+void Test::newton_estimation(void)
+{
+  Vector m0,m1,m2,spherical(3,0);
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(1000);
+  Vector sample_mean = computeVectorSum(random_sample);
+  Matrix S = computeDispersionMatrix(random_sample);
+  long double N = random_sample.size();
+
+  // exact derivatives against central differences of the objective
+  MaximumLikelihoodNewtonModel model(sample_mean,S,N);
+  struct Estimates moment = kent.computeMomentEstimates(sample_mean,S,N);
+  cartesian2spherical(moment.mean,spherical);
+  double alpha = spherical[1], eta = spherical[2];
+  cartesian2spherical(moment.major_axis,spherical);
+  double psi = (sin(spherical[2] - eta) < 0) ? PI - spherical[1] : spherical[1];
+  column_vector x(5),gradient;
+  x = alpha,eta,psi,moment.kappa,moment.beta;
+  dlib::matrix<double> hessian;
+  model.get_derivative_and_hessian(x,gradient,hessian);
+  column_vector numerical = derivative(model)(x);
+  double h = 1e-5;
+  for (int i=0; i<5; i++) {
+    column_vector xp = x, xm = x;
+    xp(i) += h; xm(i) -= h;
+    column_vector gp,gm;
+    dlib::matrix<double> tmp;
+    model.get_derivative_and_hessian(xp,gp,tmp);
+    model.get_derivative_and_hessian(xm,gm,tmp);
+    cout << "gradient[" << i << "]: " << gradient(i) << " (" << numerical(i) << ")\t";
+    cout << "hessian row " << i << ":";
+    for (int j=0; j<5; j++) {
+      cout << " " << hessian(i,j) << " (" << (gp(j) - gm(j)) / (2*h) << ")";
+    }
+    cout << endl;
+  }
+
+  string type = "MLE_UNCONSTRAINED";
+  clock_t c_start = clock();
+  struct Estimates bfgs = kent.computeMLEstimates(sample_mean,S,N,type);
+  clock_t c_end = clock();
+  print(type,bfgs);
+  cout << "time: " << (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC << " ms\n";
+
+  type = "MLE_NEWTON";
+  c_start = clock();
+  struct Estimates newton = kent.computeMLEstimates(sample_mean,S,N,type);
+  c_end = clock();
+  print(type,newton);
+  cout << "time: " << (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC << " ms\n";
+  Kent kent1(bfgs.mean,bfgs.major_axis,bfgs.minor_axis,bfgs.kappa,bfgs.beta);
+  Kent kent2(newton.mean,newton.major_axis,newton.minor_axis,newton.kappa,newton.beta);
+  cout << "negative log likelihood: " << kent1.computeNegativeLogLikelihood(sample_mean,S,N)
+       << " (BFGS); " << kent2.computeNegativeLogLikelihood(sample_mean,S,N) << " (Newton)\n";
+}
+
+/*!
+ *  Counts the heap allocations of repeated objective function evaluations
+ *  (after a first evaluation has sized the workspace)
+ */
+void Test::allocation_free_evaluation(void)
+{
+  Vector m0,m1,m2,spherical(3,0);
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(1000);
+  Vector sample_mean = computeVectorSum(random_sample);
+  Matrix S = computeDispersionMatrix(random_sample);
+  long double N = random_sample.size();
+
+  cartesian2spherical(m0,spherical);
+  double alpha = spherical[1], eta = spherical[2];
+  cartesian2spherical(m1,spherical);
+  double psi = (sin(spherical[2] - eta) < 0) ? PI - spherical[1] : spherical[1];
+  double delta = eta + acos(-1/(tan(alpha) * tan(psi)));
+  column_vector x(5),x2(2);
+  x = alpha,eta,psi,100,30;
+  x2 = 100,30;
+
+  MomentObjectiveFunction moment(m0,m1,m2,sample_mean,S,N);
+  MaximumLikelihoodObjectiveFunctionUnconstrained mle(sample_mean,S,N,x);
+  MaximumLikelihoodNewtonModel newton(sample_mean,S,N);
+  MMLObjectiveFunctionScale mml_scale(alpha,eta,psi,delta,sample_mean,S,N);
+  MMLObjectiveFunction mml(sample_mean,S,N,x);
+  moment(x2); mle(x); newton(x); mml_scale(x2); mml(x);
+
+  int num_evaluations = 100;
+  long allocations[5] = {0,0,0,0,0};
+  for (int i=0; i<num_evaluations; i++) {
+    x(0) = alpha + 1e-4 * i; x(3) = 100 + 0.1 * i;
+    x2(0) = 100 + 0.1 * i;
+
+    num_allocations = 0; count_allocations = true;
+    moment(x2);
+    count_allocations = false; allocations[0] += num_allocations;
+
+    num_allocations = 0; count_allocations = true;
+    mle(x);
+    count_allocations = false; allocations[1] += num_allocations;
+
+    num_allocations = 0; count_allocations = true;
+    newton(x);
+    count_allocations = false; allocations[2] += num_allocations;
+
+    num_allocations = 0; count_allocations = true;
+    mml_scale(x2);
+    count_allocations = false; allocations[3] += num_allocations;
+
+    num_allocations = 0; count_allocations = true;
+    mml(x);
+    count_allocations = false; allocations[4] += num_allocations;
+  }
+  string names[5] = {"MOMENT","MLE_UNCONSTRAINED","MLE_NEWTON","MML_SCALE","MML"};
+  for (int i=0; i<5; i++) {
+    cout << names[i] << ": " << allocations[i] << " heap allocations in " 
+         << num_evaluations << " evaluations\n";
+  }
+}
+void Test::batch_estimation(void)
+{
+  int num_fits = 500;
+  std::vector<struct SufficientStatistics> stats(num_fits);
+  for (int i=0; i<num_fits; i++) {
+    Vector m0,m1,m2;
+    generateRandomOrthogonalVectors(m0,m1,m2);
+    long double kappa = 10 + 10 * (i % 10);
+    Kent kent(m0,m1,m2,kappa,kappa/4);
+    std::vector<Vector> random_sample = kent.generate(50 + i % 200);
+    initializeStatistics(stats[i],3);
+    accumulateStatistics(stats[i],random_sample);
+  }
+  stats[1].N = 0;              // must be reported, not fitted
+  stats[2].sum_x = Vector(2,0);
+
+  string types[4] = {"MOMENT","MLE","MML_SCALE","MML"};
+  for (int t=0; t<4; t++) {
+    std::vector<struct Estimates> estimates;
+    std::vector<int> status;
+    for (int num_threads=1; num_threads<=4; num_threads*=4) {
+      BatchEstimator batch(types[t],num_threads);
+      auto start = std::chrono::steady_clock::now();
+      int num_ok = batch.estimate(stats,estimates,status);
+      auto end = std::chrono::steady_clock::now();
+      cout << types[t] << ": threads: " << num_threads << "; fitted: " << num_ok
+           << "/" << num_fits << "; status[1]: " << status[1]
+           << "; status[2]: " << status[2] << "; time: "
+           << std::chrono::duration<double,std::milli>(end-start).count() << " ms\n";
+    }
+    print(types[t],estimates[0]);
+  }
+}
+
+/*!
+ *  MLE and MML fits with the orientation given by angles and by a 
+ *  rotation vector
+ */
+void Test::rotation_parameterization(void)
+{
+  Vector m0,m1,m2;
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(1000);
+  Vector sample_mean = computeVectorSum(random_sample);
+  Matrix S = computeDispersionMatrix(random_sample);
+  long double N = random_sample.size();
+
+  // the objective is smooth across a full turn about the mean
+  struct Estimates moment = kent.computeMomentEstimates(sample_mean,S,N);
+  MaximumLikelihoodObjectiveFunctionRotation objective(moment.mean,moment.major_axis,sample_mean,S,N);
+  column_vector x(5);
+  for (int i=0; i<=8; i++) {
+    double t = i * PI / 4;
+    x = t*moment.mean[0],t*moment.mean[1],t*moment.mean[2],moment.kappa,moment.beta;
+    cout << "rotation about the mean by " << i*45 << " degrees: " << objective(x) << endl;
+  }
+
+  string types[2] = {"MLE_UNCONSTRAINED","MML"};
+  int parameterizations[2] = {ANGLES,ROTATION_VECTOR};
+  for (int t=0; t<2; t++) {
+    for (int p=0; p<2; p++) {
+      struct Estimates estimates = moment;
+      Optimize opt(types[t]);
+      opt.setParameterization(parameterizations[p]);
+      opt.initialize(N,moment.mean,moment.major_axis,moment.minor_axis,moment.kappa,moment.beta);
+      clock_t c_start = clock();
+      opt.computeEstimates(sample_mean,S,estimates);
+      clock_t c_end = clock();
+      print(types[t],estimates);
+      Kent fit(estimates.mean,estimates.major_axis,estimates.minor_axis,estimates.kappa,estimates.beta);
+      cout << (p == 0 ? "angles" : "rotation vector") << ": negative log likelihood: " 
+           << fit.computeNegativeLogLikelihood(sample_mean,S,N) << "; mean . major: "
+           << computeDotProduct(estimates.mean,estimates.major_axis) << "; time: "
+           << (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC << " ms\n";
+    }
+  }
+}
+
+/*!
+ *  Telemetry of the minimizations of each estimation method
+ */
+void Test::optimizer_telemetry(void)
+{
+  Vector m0,m1,m2;
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(1000);
+  Vector sample_mean = computeVectorSum(random_sample);
+  Matrix S = computeDispersionMatrix(random_sample);
+  long double N = random_sample.size();
+  struct Estimates moment = kent.computeMomentEstimates(sample_mean,S,N);
+
+  string types[5] = {"MOMENT","MLE_UNCONSTRAINED","MLE_NEWTON","MML_SCALE","MML"};
+  string reasons[NUM_STOP_REASONS] = {"none","objective delta","max iterations","min objective",
+                                      "abandoned"};
+  for (int t=0; t<5; t++) {
+    Optimize opt(types[t]);
+    for (int repeat=0; repeat<3; repeat++) {
+      struct Estimates estimates = moment;
+      opt.initialize(N,moment.mean,moment.major_axis,moment.minor_axis,moment.kappa,moment.beta);
+      opt.computeEstimates(sample_mean,S,estimates);
+    }
+    struct OptimizeResult result = opt.getResult();
+    cout << types[t] << ": objective: " << result.objective 
+         << "; iterations: " << result.iterations
+         << "; objective evaluations: " << result.objective_evaluations
+         << "; gradient evaluations: " << result.gradient_evaluations
+         << "; normalizer evaluations: " << result.normalizer_evaluations
+         << "; wall time: " << result.wall_time << " ms"
+         << "; stopped on: " << reasons[result.termination]
+         << "; gradient norm: " << result.gradient_norm << endl;
+    opt.printSummary(cout);
+  }
+}
+
+/*!
+ *  MML and MLE from a single start and from several starts in parallel
+ */
+void Test::multi_start(void)
+{
+  Vector m0,m1,m2;
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  // nearly exchangeable major and minor axes
+  Kent kent(m0,m1,m2,50,3);
+  std::vector<Vector> random_sample = kent.generate(200);
+  Vector sample_mean = computeVectorSum(random_sample);
+  Matrix S = computeDispersionMatrix(random_sample);
+  long double N = random_sample.size();
+  struct Estimates moment = kent.computeMomentEstimates(sample_mean,S,N);
+
+  string types[2] = {"MLE_UNCONSTRAINED","MML"};
+  for (int t=0; t<2; t++) {
+    struct Estimates single = moment, multi = moment;
+    Optimize opt1(types[t]);
+    opt1.initialize(N,moment.mean,moment.major_axis,moment.minor_axis,moment.kappa,moment.beta);
+    opt1.computeEstimates(sample_mean,S,single);
+    cout << types[t] << " (single start): objective: " << opt1.getResult().objective << endl;
+    print(types[t],single);
+
+    Optimize opt2(types[t]);
+    opt2.initialize(N,moment.mean,moment.major_axis,moment.minor_axis,moment.kappa,moment.beta);
+    opt2.computeEstimatesMultiStart(sample_mean,S,multi,8,4);
+    cout << types[t] << " (8 starts): objective: " << opt2.getResult().objective << endl;
+    print(types[t],multi);
+    opt2.printSummary(cout);
+  }
+}
+
+/*!
+ *  The fused series against the separate ones, and the (kappa,beta)
+ *  Newton solver against dlib's BFGS on the MOMENT and MML_SCALE objectives
+ */
+void Test::scale_solver(void)
+{
+  double kb[4][2] = {{10,2},{50,20},{100,30},{400,150}};
+  for (int i=0; i<4; i++) {
+    Kent kent1(kb[i][0],kb[i][1]);
+    long double r[MAX_SCALE_ORDER+1][MAX_SCALE_ORDER+1];
+    long double log_c = kent1.computeLogScaleSeries(MAX_SCALE_ORDER,r);
+    long double max_error = fabs(log_c - kent1.computeLogNormalizationConstant());
+    for (int n=0; n<=MAX_SCALE_ORDER; n++) {
+      for (int s=0; n+s<=MAX_SCALE_ORDER; s++) {
+        if (n == 0 && s == 0) continue;
+        long double error = fabs(log(r[n][s]) + log_c - kent1.computeLogDerivativeSeries(n,s));
+        if (error > max_error) max_error = error;
+      }
+    }
+    cout << "(k,b): (" << kb[i][0] << "," << kb[i][1] << "): "
+         << "largest error of the fused log F(n,s): " << max_error << endl;
+  }
+
+  Vector m0,m1,m2;
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(1000);
+  Vector sample_mean = computeVectorSum(random_sample);
+  Matrix S = computeDispersionMatrix(random_sample);
+  long double N = random_sample.size();
+  struct Estimates estimates = kent.computeAsymptoticMomentEstimates(sample_mean,S,N);
+  Vector spherical(3,0);
+  cartesian2spherical(estimates.mean,spherical);
+  double alpha = spherical[1], eta = spherical[2];
+  cartesian2spherical(estimates.major_axis,spherical);
+  double psi = spherical[1], delta = spherical[2];
+
+  string types[2] = {"MOMENT","MML_SCALE"};
+  for (int t=0; t<2; t++) {
+    Optimize opt(types[t]);
+    struct Estimates newton = estimates;
+    opt.initialize(N,estimates.mean,estimates.major_axis,estimates.minor_axis,
+                   estimates.kappa,estimates.beta);
+    opt.computeEstimates(sample_mean,S,newton);
+    struct OptimizeResult result = opt.getResult();
+    cout << types[t] << " (Newton): (" << newton.kappa << "," << newton.beta << ")"
+         << "; objective: " << result.objective
+         << "; iterations: " << result.iterations
+         << "; normalizer evaluations: " << result.normalizer_evaluations
+         << "; wall time: " << result.wall_time << " ms\n";
+
+    column_vector x(2);
+    x = estimates.kappa,estimates.beta;
+    long normalizer_start = Kent::normalizerEvaluations();
+    clock_t c_start = clock();
+    double fval;
+    if (t == 0) {
+      fval = find_min(bfgs_search_strategy(),objective_delta_stop_strategy(1e-10),
+                      MomentObjectiveFunction(estimates.mean,estimates.major_axis,
+                                              estimates.minor_axis,sample_mean,S,N),
+                      MomentObjectiveGradient(estimates.mean,estimates.major_axis,
+                                              estimates.minor_axis,sample_mean,S,N),
+                      x,-100);
+    } else {
+      fval = find_min(bfgs_search_strategy(),objective_delta_stop_strategy(1e-10),
+                      MMLObjectiveFunctionScale(alpha,eta,psi,delta,sample_mean,S,N),
+                      MMLObjectiveGradientScale(alpha,eta,psi,delta,sample_mean,S,N),
+                      x,-100);
+    }
+    clock_t c_end = clock();
+    cout << types[t] << " (BFGS): (" << x(0) << "," << x(1) << ")"
+         << "; objective: " << fval
+         << "; normalizer evaluations: " << Kent::normalizerEvaluations() - normalizer_start
+         << "; wall time: " << (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC << " ms\n";
+  }
+}
+
+/*!
+ *  Fits from scratch and through a WarmStartCache: refits of a growing
+ *  sample and fits of bootstrap resamples
+ */
+void Test::warm_start(void)
+{
+  Vector m0,m1,m2;
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(1200);
+  int num_fits = 20;
+  std::vector<struct SufficientStatistics> growing(num_fits),resamples(num_fits);
+  struct SufficientStatistics stats;
+  initializeStatistics(stats,3);
+  accumulateStatistics(stats,&random_sample[0][0],1,3);
+  for (int j=1; j<1000; j++) {
+    accumulateStatistics(stats,&random_sample[j][0],1,3);
+  }
+  for (int i=0; i<num_fits; i++) {
+    // 10 more points each time
+    for (int j=1000+10*i; j<1010+10*i; j++) {
+      accumulateStatistics(stats,&random_sample[j][0],1,3);
+    }
+    growing[i] = stats;
+    initializeStatistics(resamples[i],3);
+    for (int j=0; j<1000; j++) {
+      accumulateStatistics(resamples[i],&random_sample[rand() % 1000][0],1,3);
+    }
+  }
+
+  string data[2] = {"growing sample","bootstrap resamples"};
+  string types[3] = {"MLE_NEWTON","MLE_UNCONSTRAINED","MML"};
+  for (int d=0; d<2; d++) {
+    std::vector<struct SufficientStatistics> &fits = (d == 0) ? growing : resamples;
+    for (int t=0; t<3; t++) {
+      WarmStartCache cache;
+      long double max_difference = 0;
+      double cold_time = 0,warm_time = 0;
+      long cold_normalizer = 0,warm_normalizer = 0;
+      for (int i=0; i<num_fits; i++) {
+        long start = Kent::normalizerEvaluations();
+        clock_t c_start = clock();
+        struct Estimates cold = computeEstimates(fits[i],types[t]);
+        clock_t c_end = clock();
+        cold_time += (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC;
+        cold_normalizer += Kent::normalizerEvaluations() - start;
+
+        start = Kent::normalizerEvaluations();
+        c_start = clock();
+        struct Estimates warm = cache.estimate(fits[i],types[t]);
+        c_end = clock();
+        warm_time += (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC;
+        warm_normalizer += Kent::normalizerEvaluations() - start;
+
+        long double difference = fabs(cold.kappa - warm.kappa) + fabs(cold.beta - warm.beta);
+        if (difference > max_difference) max_difference = difference;
+      }
+      cout << data[d] << ": " << types[t] << ": cache hits: " << cache.numHits() << "/" << num_fits
+           << "; cold: " << cold_time << " ms, " << cold_normalizer << " normalizer evaluations"
+           << "; warm: " << warm_time << " ms, " << warm_normalizer << " normalizer evaluations"
+           << "; largest |dk| + |db|: " << max_difference << endl;
+    }
+  }
+}
+
+/*!
+ *  The scale constants from one pass of the series against the separate
+ *  series, and the cost of an MML_SCALE evaluation
+ */
+void Test::scale_constants(void)
+{
+  Vector m0,m1,m2;
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  double kb[4][2] = {{10,2},{50,20},{100,30},{400,150}};
+  for (int i=0; i<4; i++) {
+    Kent kent(m0,m1,m2,kb[i][0],kb[i][1]);
+    kent.computeScaleConstants();
+    struct Kent::Constants constants = kent.constants;
+    cout << "(k,b): (" << kb[i][0] << "," << kb[i][1] << "): differences: "
+         << constants.log_c - kent.computeLogNormalizationConstant() << " "
+         << constants.log_ck - kent.log_dc_dk() << " "
+         << constants.log_cb - kent.log_dc_db() << " "
+         << constants.log_ckk - kent.log_d2c_dk2() << " "
+         << constants.log_ckb - kent.log_d2c_dkdb() << " "
+         << constants.log_cbb - kent.log_d2c_db2() << endl;
+  }
+
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(1000);
+  Vector sample_mean = computeVectorSum(random_sample);
+  Matrix S = computeDispersionMatrix(random_sample);
+  long double N = random_sample.size();
+  Vector spherical(3,0);
+  cartesian2spherical(m0,spherical);
+  double alpha = spherical[1], eta = spherical[2];
+  cartesian2spherical(m1,spherical);
+  double psi = spherical[1], delta = spherical[2];
+  MMLObjectiveFunctionScale mml(alpha,eta,psi,delta,sample_mean,S,N);
+  column_vector x(2);
+  int num_evaluations = 1000;
+  long start = Kent::normalizerEvaluations();
+  clock_t c_start = clock();
+  double fval = 0;
+  for (int i=0; i<num_evaluations; i++) {
+    x = 90 + 0.01 * i,30;
+    fval += mml(x);
+  }
+  clock_t c_end = clock();
+  cout << "MML_SCALE objective: " << num_evaluations << " evaluations; "
+       << (Kent::normalizerEvaluations() - start) / (double) num_evaluations
+       << " series per evaluation; " 
+       << (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC / num_evaluations 
+       << " ms per evaluation (sum " << fval << ")\n";
+}
+
+/*!
+ *  The Fisher information of a Kent object re-parameterized one 
+ *  coordinate at a time (the blocks not changed are reused) against 
+ *  fresh objects, and the cost of the numerical gradient of the MML 
+ *  objective
+ */
+void Test::fisher_cache(void)
+{
+  Vector m0,m1,m2,spherical(3,0);
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(1000);
+  Vector sample_mean = computeVectorSum(random_sample);
+  Matrix S = computeDispersionMatrix(random_sample);
+  long double N = random_sample.size();
+  struct Estimates moment = kent.computeMomentEstimates(sample_mean,S,N);
+  cartesian2spherical(moment.mean,spherical);
+  double alpha = spherical[1], eta = spherical[2];
+  cartesian2spherical(moment.major_axis,spherical);
+  double psi = spherical[1], delta = spherical[2];
+
+  // delta is kept with the angles: the test only needs a valid frame
+  double x[6] = {alpha,eta,psi,delta,moment.kappa,moment.beta};
+  Kent cached(x[0],x[1],x[2],x[3],x[4],x[5]);
+  long double max_error = 0;
+  for (int i=0; i<30; i++) {
+    int j = (i % 3 == 2) ? 4 + (i / 3) % 2 : i % 3;  // angle, angle, scale, ...
+    x[j] += (j < 3) ? 1e-3 : 0.1;
+    cached.setParameters(x[0],x[1],x[2],x[3],x[4],x[5]);
+    Kent fresh(x[0],x[1],x[2],x[3],x[4],x[5]);
+    long double error = fabs(cached.computeLogFisherInformation() 
+                             - fresh.computeLogFisherInformation());
+    if (error > max_error) max_error = error;
+  }
+  cout << "largest difference of log det(fisher), cached vs fresh: " << max_error << endl;
+
+  column_vector theta(5);
+  theta = alpha,eta,psi,moment.kappa,moment.beta;
+  MMLObjectiveFunction mml(sample_mean,S,N,theta);
+  int num_gradients = 100;
+  long start = Kent::normalizerEvaluations();
+  clock_t c_start = clock();
+  for (int i=0; i<num_gradients; i++) {
+    column_vector gradient = derivative(mml)(theta);
+  }
+  clock_t c_end = clock();
+  cout << "MML numerical gradient: " 
+       << (Kent::normalizerEvaluations() - start) / (double) num_gradients
+       << " series per gradient; "
+       << (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC / num_gradients
+       << " ms per gradient\n";
+}
+
+void Test::differentials_benchmark(void)
+{
+  Vector m0,m1,m2,spherical(3,0);
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(1000);
+  Vector sample_mean = computeVectorSum(random_sample);
+  Matrix S = computeDispersionMatrix(random_sample);
+  long double N = random_sample.size();
+  cartesian2spherical(m0,spherical);
+  double alpha = spherical[1], eta = spherical[2];
+  cartesian2spherical(m1,spherical);
+  double psi = spherical[1], delta = spherical[2];
+
+  // the angles change at every evaluation so that the differentials of
+  // the axes are recomputed; the scale constants stay cached
+  Kent moving(alpha,eta,psi,delta,100,30);
+  int num_evaluations = 100000;
+  long double sum = 0;
+  clock_t c_start = clock();
+  for (int i=0; i<num_evaluations; i++) {
+    moving.differentials_computed = 0;
+    moving.computeDifferentials(2);
+    sum += moving.df.d2_mi[5][0];
+  }
+  clock_t c_end = clock();
+  double seconds = (c_end - c_start) / (double) CLOCKS_PER_SEC;
+  cout << "differentials of the axes: " << num_evaluations / seconds 
+       << " evaluations per second\n";
+
+  sum = 0;
+  c_start = clock();
+  for (int i=0; i<num_evaluations; i++) {
+    double h = (i % 2) ? 1e-4 : -1e-4;
+    moving.setParameters(alpha+h,eta+h,psi+h,delta,100,30);
+    sum += moving.computeLogFisherInformation();
+  }
+  c_end = clock();
+  seconds = (c_end - c_start) / (double) CLOCKS_PER_SEC;
+  cout << "Fisher information: " << num_evaluations / seconds 
+       << " evaluations per second (" << sum / num_evaluations << ")\n";
+
+  c_start = clock();
+  for (int i=0; i<num_evaluations; i++) {
+    double h = (i % 2) ? 1e-4 : -1e-4;
+    moving.setParameters(alpha+h,eta+h,psi+h,delta,100,30);
+    Matrix hessian = moving.computeHessianNegativeLogLikelihood(sample_mean,S,N);
+    sum += hessian(0,0);
+  }
+  c_end = clock();
+  seconds = (c_end - c_start) / (double) CLOCKS_PER_SEC;
+  cout << "Hessian of the negative log likelihood: " << num_evaluations / seconds 
+       << " evaluations per second\n";
+}
+
+void Test::fisher_grid(void)
+{
+  std::vector<long double> alpha,eta,psi,kappa,beta;
+  for (int i=1; i<=6; i++) {
+    alpha.push_back(i * PI / 7);
+    eta.push_back(i * PI / 4);
+    psi.push_back(i * PI / 7);
+  }
+  for (int i=1; i<=8; i++) {
+    kappa.push_back(10 * i);
+    beta.push_back(4 * i);
+  }
+
+  FisherGrid grid;
+  std::vector<long double> log_fisher;
+  clock_t c_start = clock();
+  grid.evaluate(alpha,eta,psi,kappa,beta,log_fisher);
+  clock_t c_end = clock();
+  double batched = (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC;
+
+  // one Kent at a time
+  long num_valid = 0;
+  long double max_error = 0;
+  std::vector<Vector> points;
+  std::vector<long double> values;
+  c_start = clock();
+  for (int a=0; a<alpha.size(); a++) {
+    for (int n=0; n<eta.size(); n++) {
+      for (int s=0; s<psi.size(); s++) {
+        long double tmp = -1/(tan(alpha[a]) * tan(psi[s]));
+        for (int k=0; k<kappa.size(); k++) {
+          for (int b=0; b<beta.size(); b++) {
+            Vector x(5,0);
+            x[0] = alpha[a]; x[1] = eta[n]; x[2] = psi[s]; x[3] = kappa[k]; x[4] = beta[b];
+            points.push_back(x);
+            if (fabs(tmp) >= 1 || 2 * beta[b] >= kappa[k]) {
+              values.push_back(std::numeric_limits<long double>::quiet_NaN());
+              continue;
+            }
+            Kent kent(alpha[a],eta[n],psi[s],eta[n]+acos(tmp),kappa[k],beta[b]);
+            values.push_back(kent.computeLogFisherInformation());
+            num_valid++;
+          }
+        }
+      }
+    }
+  }
+  c_end = clock();
+  double single = (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC;
+  int mismatched_nan = 0;
+  for (int i=0; i<values.size(); i++) {
+    if (std::isnan(values[i]) != std::isnan(log_fisher[i])) mismatched_nan++;
+    else if (!std::isnan(values[i])) {
+      max_error = std::max(max_error,fabs(values[i] - log_fisher[i]));
+    }
+  }
+  cout << "grid of " << log_fisher.size() << " (" << num_valid << " valid): "
+       << "largest difference to one at a time: " << max_error 
+       << "; NaN mismatches: " << mismatched_nan << endl;
+  cout << "one at a time: " << single << " ms; grid: " << batched << " ms ("
+       << grid.numThreads() << " threads)\n";
+
+  std::vector<long double> point_values;
+  c_start = clock();
+  grid.evaluate(points,point_values);
+  c_end = clock();
+  max_error = 0;
+  for (int i=0; i<values.size(); i++) {
+    if (!std::isnan(values[i])) {
+      max_error = std::max(max_error,fabs(values[i] - point_values[i]));
+    }
+  }
+  cout << "parameter array: largest difference: " << max_error << "; "
+       << (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC << " ms\n";
+}
+
+void Test::message_length(void)
+{
+  Vector m0,m1,m2,spherical(3,0);
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(1000);
+  Vector sample_mean = computeVectorSum(random_sample);
+  Matrix S = computeDispersionMatrix(random_sample);
+  long double N = random_sample.size();
+  cartesian2spherical(m0,spherical);
+  double alpha = spherical[1], eta = spherical[2];
+  cartesian2spherical(m1,spherical);
+  double psi = spherical[1];
+  // the branch of delta that MMLObjectiveFunction takes
+  double delta = eta + acos(-1/(tan(alpha) * tan(psi)));
+
+  Kent model(alpha,eta,psi,delta,100,30);
+  struct MessageLength ml = model.computeMessageLength(sample_mean,S,N);
+  cout << "log prior: " << ml.log_prior_axes << " (axes) " << ml.log_prior_scale << " (scale)\n";
+  cout << "log fisher: " << ml.log_fisher_axes << " (axes) " << ml.log_fisher_scale 
+       << " (scale) " << ml.log_fisher_sample_size << " (5 log N)\n";
+  cout << "negative log likelihood: " << ml.negative_log_likelihood 
+       << "; lattice: " << ml.lattice << "; precision: " << ml.precision << endl;
+  cout << "first part: " << ml.first_part << "; second part: " << ml.second_part
+       << "; total: " << ml.total << endl;
+  column_vector theta(5);
+  theta = alpha,eta,psi,100,30;
+  MMLObjectiveFunction mml(sample_mean,S,N,theta);
+  cout << "MMLObjectiveFunction: " << mml(theta) << endl;
+
+  // the same model over many candidate samples
+  int num_samples = 200;
+  std::vector<Vector> sum_x;
+  std::vector<Matrix> sum_xx;
+  std::vector<long double> sizes;
+  for (int i=0; i<num_samples; i++) {
+    std::vector<Vector> sample = kent.generate(100 + 10 * i);
+    sum_x.push_back(computeVectorSum(sample));
+    sum_xx.push_back(computeDispersionMatrix(sample));
+    sizes.push_back(sample.size());
+  }
+  std::vector<long double> full(num_samples),incremental(num_samples);
+  long start = Kent::normalizerEvaluations();
+  clock_t c_start = clock();
+  for (int i=0; i<num_samples; i++) {
+    Kent fresh(alpha,eta,psi,delta,100,30);
+    full[i] = fresh.computeMessageLength(sum_x[i],sum_xx[i],sizes[i]).total;
+  }
+  clock_t c_end = clock();
+  long full_series = Kent::normalizerEvaluations() - start;
+  double full_time = (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC;
+
+  start = Kent::normalizerEvaluations();
+  c_start = clock();
+  for (int i=0; i<num_samples; i++) {
+    model.updateMessageLength(ml,sum_x[i],sum_xx[i],sizes[i]);
+    incremental[i] = ml.total;
+  }
+  c_end = clock();
+  long incremental_series = Kent::normalizerEvaluations() - start;
+  double incremental_time = (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC;
+  long double max_error = 0;
+  for (int i=0; i<num_samples; i++) {
+    max_error = std::max(max_error,fabs(full[i] - incremental[i]));
+  }
+  cout << num_samples << " samples: full " << full_time << " ms (" << full_series 
+       << " series); incremental " << incremental_time << " ms (" << incremental_series
+       << " series); largest difference " << max_error << endl;
+}
+
+/*!
+ *  \brief Largest difference between the gradient g of f at x and its
+ *  central differences
+ */
+template <class F, class G>
+static double gradientError(const F &f, const G &g, const column_vector &x)
+{
+  column_vector gradient = g(x);
+  double max_error = 0;
+  for (int i=0; i<x.size(); i++) {
+    double h = 1e-5 * std::max(1.0,fabs(x(i)));
+    column_vector xp = x, xm = x;
+    xp(i) += h; xm(i) -= h;
+    double numerical = (f(xp) - f(xm)) / (2 * h);
+    max_error = std::max(max_error,fabs(gradient(i) - numerical) / std::max(1.0,fabs(numerical)));
+  }
+  return max_error;
+}
+
+void Test::dual_gradient(void)
+{
+  Vector m0,m1,m2,spherical(3,0);
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(1000);
+  Vector sample_mean = computeVectorSum(random_sample);
+  Matrix S = computeDispersionMatrix(random_sample);
+  long double N = random_sample.size();
+  cartesian2spherical(m0,spherical);
+  double alpha = spherical[1], eta = spherical[2];
+  cartesian2spherical(m1,spherical);
+  double psi = spherical[1];
+
+  // the gradients against central differences, away from the start
+  column_vector sp(5),x(5),w(5);
+  sp = alpha,eta,psi,100,30;
+  x = alpha+0.01,eta-0.01,psi+0.01,90,25;
+  double x3,x4;
+  MMLObjectiveFunctionRotation::setScale(90,25,x3,x4);
+  w = 0.01,-0.02,0.01,90,25;
+  cout << scientific << "relative gradient errors: MLE (angles) "
+       << gradientError(MaximumLikelihoodObjectiveFunctionUnconstrained(sample_mean,S,N,sp),
+                        MaximumLikelihoodGradientUnconstrained(sample_mean,S,N,sp),x)
+       << "; MLE (rotation) "
+       << gradientError(MaximumLikelihoodObjectiveFunctionRotation(m0,m1,sample_mean,S,N),
+                        MaximumLikelihoodGradientRotation(m0,m1,sample_mean,S,N),w);
+  w(3) = x3; w(4) = x4;
+  cout << "; MML (angles) "
+       << gradientError(MMLObjectiveFunction(sample_mean,S,N,sp),MMLGradient(sample_mean,S,N,sp),x)
+       << "; MML (rotation) "
+       << gradientError(MMLObjectiveFunctionRotation(m0,m1,sample_mean,S,N),
+                        MMLGradientRotation(m0,m1,sample_mean,S,N),w) << endl;
+
+  // KL divergence of kent from (alpha,eta,psi,k,b), delta solved
+  double delta = eta + acos(-1/(tan(alpha) * tan(psi)));
+  DualKent dual;
+  dual.setParameters(KentDual::variable(alpha,0),KentDual::variable(eta,1),
+                     KentDual::variable(psi,2),delta,KentDual::variable(90,3),
+                     KentDual::variable(25,4));
+  KentDual kl = dual.klDivergence(kent);
+  Kent model(alpha,eta,psi,delta,90,25);
+  cout << "KL divergence: " << kl.value << " (Kent: " << model.computeKLDivergence(kent) 
+       << "); d/dk " << kl.d[3] << " (numerical: ";
+  Kent kp(alpha,eta,psi,delta,90+1e-4,25),km(alpha,eta,psi,delta,90-1e-4,25);
+  cout << (kp.computeKLDivergence(kent) - km.computeKLDivergence(kent)) / 2e-4 << ")\n" << fixed;
+
+  // BFGS with the exact gradients and with numerical ones, from the
+  // moment estimates (as Optimize)
+  struct Estimates moment = kent.computeMomentEstimates(sample_mean,S,N);
+  MMLObjectiveFunctionRotation::setScale(moment.kappa,moment.beta,x3,x4);
+  column_vector start(5);
+  start = 0,0,0,x3,x4;
+  for (int exact=0; exact<2; exact++) {
+    struct OptimizeResult result;
+    result.iterations = result.objective_evaluations = result.gradient_evaluations = 0;
+    column_vector solution = start;
+    clock_t c_start = clock();
+    if (exact) {
+      result.objective = find_min(
+        bfgs_search_strategy(),
+        TelemetryStopStrategy(1e-10,&result),
+        counted(MMLObjectiveFunctionRotation(moment.mean,moment.major_axis,sample_mean,S,N),&result.objective_evaluations),
+        counted(MMLGradientRotation(moment.mean,moment.major_axis,sample_mean,S,N),&result.gradient_evaluations),
+        solution,
+        -100
+      );
+    } else {
+      result.objective = find_min_using_approximate_derivatives(
+        bfgs_search_strategy(),
+        TelemetryStopStrategy(1e-10,&result),
+        counted(MMLObjectiveFunctionRotation(moment.mean,moment.major_axis,sample_mean,S,N),&result.objective_evaluations),
+        solution,
+        -100
+      );
+    }
+    clock_t c_end = clock();
+    cout << (exact ? "exact" : "numerical") << " gradients: message length " 
+         << result.objective << "; iterations " << result.iterations
+         << "; objective evaluations " << result.objective_evaluations
+         << "; gradient evaluations " << result.gradient_evaluations << "; "
+         << (c_end - c_start) * 1000.0 / CLOCKS_PER_SEC << " ms; solution "
+         << solution(0) << " " << solution(1) << " " << solution(2) << " " 
+         << solution(3) << " " << solution(4) << endl;
+  }
+}
+
+void Test::kent_mixture(void)
+{
+  int K = 3;
+  long double kappas[3] = {20,50,100},betas[3] = {5,20,30};
+  int sizes[3] = {100000,200000,300000};
+  std::vector<Kent> truth;
+  std::vector<Vector> data;
+  for (int k=0; k<K; k++) {
+    Vector m0,m1,m2;
+    generateRandomOrthogonalVectors(m0,m1,m2);
+    truth.push_back(Kent(m0,m1,m2,kappas[k],betas[k]));
+    std::vector<Vector> sample = truth[k].generate(sizes[k]);
+    data.insert(data.end(),sample.begin(),sample.end());
+  }
+  long double true_log_likelihood = 0,log_c[3];
+  for (int k=0; k<K; k++) {
+    log_c[k] = truth[k].computeLogNormalizationConstant();
+  }
+  for (long i=0; i<data.size(); i++) {
+    long double density = 0;
+    for (int k=0; k<K; k++) {
+      Vector &x = data[i];
+      Vector m0 = truth[k].Mean(),m1 = truth[k].MajorAxis(),m2 = truth[k].MinorAxis();
+      long double mj = computeDotProduct(m1,x),mi = computeDotProduct(m2,x);
+      density += sizes[k] / (long double) data.size() 
+                 * exp(kappas[k] * computeDotProduct(m0,x) + betas[k] * (mj*mj - mi*mi) - log_c[k]);
+    }
+    true_log_likelihood += log(density);
+  }
+
+  string types[2] = {"MOMENT","MLE"};
+  for (int t=0; t<2; t++) {
+    KentMixture mixture(K,types[t]);
+    auto start = std::chrono::steady_clock::now();
+    int iterations = mixture.estimate(data);
+    auto end = std::chrono::steady_clock::now();
+    double ms = std::chrono::duration<double,std::milli>(end - start).count();
+    cout << types[t] << ": " << data.size() << " points, " << K << " components, "
+         << mixture.numThreads() << " threads: " << iterations << " iterations; "
+         << ms << " ms; log likelihood " << mixture.logLikelihood() 
+         << " (true parameters: " << true_log_likelihood << ")\n";
+    Vector weights = mixture.getWeights();
+    std::vector<struct Estimates> estimates = mixture.getEstimates();
+    for (int k=0; k<K; k++) {
+      // the closest true component
+      int closest = 0;
+      long double best = -2;
+      for (int j=0; j<K; j++) {
+        Vector m0 = truth[j].Mean();
+        long double cos_angle = computeDotProduct(m0,estimates[k].mean);
+        if (cos_angle > best) {
+          best = cos_angle;
+          closest = j;
+        }
+      }
+      cout << "  weight " << weights[k] << " (" << sizes[closest] / (long double) data.size()
+           << "); kappa " << estimates[k].kappa << " (" << kappas[closest] << "); beta "
+           << estimates[k].beta << " (" << betas[closest] << "); mean . true mean " << best << endl;
+    }
+  }
+
+  // the cost with tens of components
+  KentMixture large(20,"MOMENT");
+  auto start = std::chrono::steady_clock::now();
+  int iterations = large.estimate(data);
+  auto end = std::chrono::steady_clock::now();
+  double ms = std::chrono::duration<double,std::milli>(end - start).count();
+  cout << "20 components: " << iterations << " iterations; " << ms << " ms ("
+       << ms / iterations << " ms per iteration); log likelihood " << large.logLikelihood() << endl;
+}
+
+void Test::vmf_mixture(void)
+{
+  // the normalization constant: closed form in 3D, series and uniform
+  // expansion on either side of BESSEL_UNIFORM_ORDER
+  Vector z(3,0); z[2] = 1;
+  vMF vmf3(z,10);
+  cout << "log C_3(10): " << vmf3.getLogNormalizationConstant() << " (closed form: "
+       << log(10 / (4 * PI * sinh(10.0L))) << ")\n";
+  cout << "log I_v(x), series/uniform: ";
+  for (int v=10; v<=20; v+=5) {
+    long double x = 3 * v;
+    cout << "v = " << v << ": " << logModifiedBesselFirstKind(v - 0.5,x) << " / "
+         << logModifiedBesselFirstKindUniform(v - 0.5,x) << "; ";
+  }
+  cout << endl;
+
+  int D = 128, K = 5, n = 2000;
+  long double kappas[5] = {100,200,300,500,1000};
+  std::vector<Vector> data;
+  std::vector<Vector> true_means;
+  Normal normal(0,1);
+  for (int k=0; k<K; k++) {
+    Vector direction = normal.generate(D),mu(D,0);
+    normalize(direction,mu);
+    true_means.push_back(mu);
+    vMF component(mu,kappas[k]);
+    std::vector<Vector> sample = component.generate(n * (k+1));
+    data.insert(data.end(),sample.begin(),sample.end());
+  }
+  cout << endl;
+
+  vMFMixture mixture(K);
+  auto start = std::chrono::steady_clock::now();
+  int iterations = mixture.estimate(data);
+  auto end = std::chrono::steady_clock::now();
+  double ms = std::chrono::duration<double,std::milli>(end - start).count();
+  cout << data.size() << " points, D = " << D << ", " << K << " components: " << iterations
+       << " iterations; " << ms << " ms; log likelihood " << mixture.logLikelihood() << endl;
+  Vector weights = mixture.getWeights();
+  std::vector<vMF> components = mixture.getComponents();
+  for (int k=0; k<K; k++) {
+    Vector mu = components[k].mean();
+    int closest = 0;
+    long double best = -2;
+    for (int j=0; j<K; j++) {
+      long double cos_angle = computeDotProduct(mu,true_means[j]);
+      if (cos_angle > best) {
+        best = cos_angle;
+        closest = j;
+      }
+    }
+    cout << "  weight " << weights[k] << " (" << n * (closest+1) / (long double) data.size()
+         << "); kappa " << components[k].Kappa() << " (" << kappas[closest]
+         << "); mean . true mean " << best << endl;
+  }
+
+  // the cost of an iteration with more components and points
+  std::vector<Vector> large;
+  for (int i=0; i<4; i++) {
+    large.insert(large.end(),data.begin(),data.end());
+  }
+  vMFMixture wide(32);
+  wide.setMaxIterations(20);
+  start = std::chrono::steady_clock::now();
+  iterations = wide.estimate(large);
+  end = std::chrono::steady_clock::now();
+  ms = std::chrono::duration<double,std::milli>(end - start).count();
+  cout << large.size() << " points, D = " << D << ", 32 components: " << iterations
+       << " iterations; " << ms / (iterations + VMF_MIXTURE_SEED_ITERATIONS)
+       << " ms per E-step\n";
+}
+
+void Test::mixture_search(void)
+{
+  int K = 3;
+  long double kappas[3] = {20,50,100},betas[3] = {5,20,30};
+  int sizes[3] = {5000,10000,15000};
+  std::vector<Vector> data;
+  for (int k=0; k<K; k++) {
+    Vector m0,m1,m2;
+    generateRandomOrthogonalVectors(m0,m1,m2);
+    Kent component(m0,m1,m2,kappas[k],betas[k]);
+    std::vector<Vector> sample = component.generate(sizes[k]);
+    data.insert(data.end(),sample.begin(),sample.end());
+  }
+
+  MixtureSearch search("MLE",4);
+  auto start = std::chrono::steady_clock::now();
+  struct MixtureCandidate best = search.search(data);
+  auto end = std::chrono::steady_clock::now();
+  double ms = std::chrono::duration<double,std::milli>(end - start).count();
+  std::vector<struct MixtureCandidate> history = search.getHistory();
+  for (int i=0; i<history.size(); i++) {
+    cout << history[i].move << ": " << history[i].K << " components, message length "
+         << history[i].message_length << " (log likelihood " << history[i].log_likelihood
+         << ", " << history[i].iterations << " iterations)\n";
+  }
+  cout << "best: " << best.K << " components (" << K << " true); " << search.numCandidates()
+       << " candidates on " << search.numThreads() << " threads in " << ms
+       << " ms; " << search.numCacheHits() << " fits warm started from the shared cache\n";
+  for (int k=0; k<best.K; k++) {
+    cout << "  weight " << best.weights[k] << "; kappa " << best.estimates[k].kappa
+         << "; beta " << best.estimates[k].beta << endl;
+  }
+}
+
+void Test::online_mixture(void)
+{
+  int K = 3;
+  long double kappas[3] = {20,50,100},betas[3] = {5,20,30};
+  long double true_weights[3] = {1.0/6,1.0/3,0.5};
+  std::vector<Kent> truth;
+  for (int k=0; k<K; k++) {
+    Vector m0,m1,m2;
+    generateRandomOrthogonalVectors(m0,m1,m2);
+    truth.push_back(Kent(m0,m1,m2,kappas[k],betas[k]));
+  }
+  // the stream: the components interleaved in blocks, written to a file
+  int num_blocks = 100, block_size = 6000;
+  std::vector<Vector> random_sample;
+  for (int b=0; b<num_blocks; b++) {
+    for (int k=0; k<K; k++) {
+      std::vector<Vector> block = truth[k].generate(block_size * true_weights[k]);
+      random_sample.insert(random_sample.end(),block.begin(),block.end());
+    }
+  }
+  string binary_file = "./visualize/kent_mixture_stream.bin";
+  writeSampleFile(binary_file.c_str(),random_sample,DOUBLE_PRECISION);
+
+  MappedSample mapped(binary_file);
+  OnlineKentMixture online(K,"MLE",0.99999,4096);
+  int chunk = 10000;
+  auto start = std::chrono::steady_clock::now();
+  for (uint64_t first=0; first<mapped.size(); first+=chunk) {
+    long rows = std::min((uint64_t) chunk,mapped.size() - first);
+    online.add(mapped.row<double>(first),rows);
+    mapped.release(first,first + rows);
+    if ((first / chunk) % 10 == 0) {
+      cout << "points: " << online.numberOfPoints() << "; N_eff: " << online.effectiveSampleSize()
+           << "; log likelihood per point of the last batch: "
+           << online.batchLogLikelihood() / 4096 << endl;
+    }
+  }
+  online.flush();
+  auto end = std::chrono::steady_clock::now();
+  double ms = std::chrono::duration<double,std::milli>(end - start).count();
+
+  // the same points read without fitting, and their E-steps alone
+  start = std::chrono::steady_clock::now();
+  volatile double checksum = 0;
+  for (uint64_t i=0; i<mapped.size(); i++) {
+    checksum += mapped.row<double>(i)[2];
+  }
+  end = std::chrono::steady_clock::now();
+  double read_ms = std::chrono::duration<double,std::milli>(end - start).count();
+  cout << online.numberOfPoints() << " points in " << online.numberOfBatches() << " batches: "
+       << ms << " ms (" << online.numberOfPoints() / ms * 1000 << " points/s; reading alone "
+       << read_ms << " ms)\n";
+
+  Vector weights = online.getWeights();
+  std::vector<struct Estimates> estimates = online.getEstimates();
+  for (int k=0; k<K; k++) {
+    int closest = 0;
+    long double best = -2;
+    for (int j=0; j<K; j++) {
+      Vector m0 = truth[j].Mean();
+      long double cos_angle = computeDotProduct(m0,estimates[k].mean);
+      if (cos_angle > best) {
+        best = cos_angle;
+        closest = j;
+      }
+    }
+    cout << "  weight " << weights[k] << " (" << true_weights[closest] << "); kappa "
+         << estimates[k].kappa << " (" << kappas[closest] << "); beta " << estimates[k].beta
+         << " (" << betas[closest] << "); mean . true mean " << best << endl;
+  }
+}
+
+void Test::log_density(void)
+{
+  Vector m0,m1,m2;
+  generateRandomOrthogonalVectors(m0,m1,m2);
+  Kent kent(m0,m1,m2,100,30);
+  std::vector<Vector> random_sample = kent.generate(1000000);
+  long N = random_sample.size();
+  std::vector<double> points(3 * N),batch(N);
+  for (long i=0; i<N; i++) {
+    for (int j=0; j<3; j++) {
+      points[3*i+j] = random_sample[i][j];
+    }
+  }
+
+  // agreement: single point, batch and the negative log likelihood
+  kent.log_density(&points[0],N,&batch[0]);
+  long double max_diff = 0,sum = 0;
+  for (long i=0; i<N; i++) {
+    long double diff = fabs(kent.log_density(random_sample[i]) - batch[i]);
+    if (diff > max_diff) max_diff = diff;
+    sum += batch[i];
+  }
+  cout << "max |single - batch|: " << max_diff << endl;
+  cout << "sum of log densities + negative log likelihood: "
+       << sum + kent.computeNegativeLogLikelihood(random_sample) << endl;
+
+  // throughput
+  int repeats = 20;
+  auto start = std::chrono::steady_clock::now();
+  for (int r=0; r<repeats; r++) {
+    kent.log_density(&points[0],N,&batch[0]);
+  }
+  auto end = std::chrono::steady_clock::now();
+  double ms = std::chrono::duration<double,std::milli>(end - start).count();
+  start = std::chrono::steady_clock::now();
+  for (long i=0; i<N; i++) {
+    batch[i] = kent.log_density(random_sample[i]);
+  }
+  end = std::chrono::steady_clock::now();
+  double single_ms = std::chrono::duration<double,std::milli>(end - start).count();
+  cout << "batch: " << repeats * N / ms / 1000 << " million points/s; single: "
+       << N / single_ms / 1000 << " million points/s\n";
+}
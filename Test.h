@@ -39,6 +39,56 @@ class Test
     void fisher();
 
     void mml_estimation(void);
+
+    void binary_sample_file(void);
+
+    void text_parser(void);
+
+    void sample_writer(void);
+
+    void file_estimation(void);
+
+    void online_estimation(void);
+
+    void gradients(void);
+
+    void newton_estimation(void);
+
+    void allocation_free_evaluation(void);
+
+    void batch_estimation(void);
+
+    void rotation_parameterization(void);
+
+    void optimizer_telemetry(void);
+
+    void multi_start(void);
+
+    void scale_solver(void);
+
+    void warm_start(void);
+
+    void scale_constants(void);
+
+    void fisher_cache(void);
+
+    void differentials_benchmark(void);
+
+    void fisher_grid(void);
+
+    void message_length(void);
+
+    void dual_gradient(void);
+
+    void kent_mixture(void);
+
+    void vmf_mixture(void);
+
+    void mixture_search(void);
+
+    void online_mixture(void);
+
+    void log_density(void);
 };
 
 #endif
@@ -0,0 +1,237 @@
+#include "TextParser.h"
+
+#include <charconv>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static inline bool isBlank(char c)
+{
+  return c == ' ' || c == '\t' || c == '\r';
+}
+
+/*!
+ *  Null constructor: one chunk per OpenMP thread
+ */
+TextParser::TextParser() : num_threads(omp_get_max_threads())
+{}
+
+TextParser::TextParser(int num_threads) : num_threads(num_threads)
+{
+  if (this->num_threads < 1) this->num_threads = 1;
+}
+
+/*!
+ *  \brief Maps a text file and parses it.
+ *  \param file_name a reference to a string
+ *  \param sample a reference to a TextSample
+ *  \return false if the file could not be read
+ */
+bool TextParser::parse(string &file_name, struct TextSample &sample)
+{
+  sample.D = 0;
+  int fd = open(file_name.c_str(),O_RDONLY);
+  if (fd < 0) {
+    cout << "Error: unable to open " << file_name << endl;
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd,&st) != 0) {
+    cout << "Error: unable to read " << file_name << endl;
+    close(fd);
+    return false;
+  }
+  if (st.st_size == 0) {
+    close(fd);
+    return parse(NULL,0,sample);
+  }
+  void *map = mmap(NULL,st.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    cout << "Error: mmap failed for " << file_name << endl;
+    return false;
+  }
+  madvise(map,st.st_size,MADV_SEQUENTIAL);
+  bool status = parse(static_cast<const char *>(map),st.st_size,sample);
+  munmap(map,st.st_size);
+
+  for (int i=0; i<sample.errors.size() && i<MAX_REPORTED_ERRORS; i++) {
+    cout << "Error: " << file_name << ":" << sample.errors[i].line << ": "
+         << sample.errors[i].reason << endl;
+  }
+  if (sample.errors.size() > MAX_REPORTED_ERRORS) {
+    cout << "... " << sample.errors.size() - MAX_REPORTED_ERRORS
+         << " more malformed lines in " << file_name << endl;
+  }
+  return status;
+}
+
+/*!
+ *  \brief Parses a buffer of text. Unless sample.D is already set (as when
+ *  a file is parsed block by block) the dimensionality is taken from the
+ *  first non-blank line; every other line must have as many values.
+ *  \param buffer a pointer to the text
+ *  \param size the number of bytes in the buffer
+ *  \param sample a reference to a TextSample
+ *  \return true
+ */
+bool TextParser::parse(const char *buffer, size_t size, struct TextSample &sample)
+{
+  if (sample.D < 0) sample.D = 0;
+  sample.N = 0;
+  sample.values.clear();
+  sample.errors.clear();
+
+  const char *end = buffer + size;
+  // dimensionality: number of tokens on the first non-blank line
+  for (const char *p = buffer; p < end && sample.D == 0; ) {
+    const char *eol = static_cast<const char *>(memchr(p,'\n',end-p));
+    if (eol == NULL) eol = end;
+    for (const char *q = p; q < eol; ) {
+      while (q < eol && isBlank(*q)) q++;
+      if (q == eol) break;
+      sample.D++;
+      while (q < eol && !isBlank(*q)) q++;
+    }
+    p = eol + 1;
+  }
+  if (sample.D == 0) {
+    return true;
+  }
+
+  // chunk boundaries at newlines
+  int num_chunks = num_threads;
+  if (size < num_chunks * 4096) num_chunks = 1;
+  std::vector<const char *> begin(num_chunks+1);
+  begin[0] = buffer;
+  begin[num_chunks] = end;
+  for (int t=1; t<num_chunks; t++) {
+    const char *p = buffer + (size * t) / num_chunks;
+    if (p < begin[t-1]) p = begin[t-1];
+    const char *eol = static_cast<const char *>(memchr(p,'\n',end-p));
+    begin[t] = (eol == NULL) ? end : eol + 1;
+  }
+
+  std::vector<std::vector<long double> > values(num_chunks);
+  std::vector<std::vector<struct ParseError> > errors(num_chunks);
+  std::vector<long> lines(num_chunks,0);
+  #pragma omp parallel for num_threads(num_chunks) schedule(static,1)
+  for (int t=0; t<num_chunks; t++) {
+    lines[t] = parseChunk(begin[t],begin[t+1],sample.D,values[t],errors[t]);
+  }
+
+  // stitch the chunks together and make line numbers global
+  long rows = 0;
+  for (int t=0; t<num_chunks; t++) {
+    rows += values[t].size() / sample.D;
+  }
+  sample.N = rows;
+  sample.values.resize(rows * sample.D);
+  long offset = 0,line_offset = 0;
+  for (int t=0; t<num_chunks; t++) {
+    if (values[t].size()) {
+      memcpy(&sample.values[offset],&values[t][0],values[t].size()*sizeof(long double));
+      offset += values[t].size();
+    }
+    for (int i=0; i<errors[t].size(); i++) {
+      errors[t][i].line += line_offset;
+      sample.errors.push_back(errors[t][i]);
+    }
+    line_offset += lines[t];
+  }
+  return true;
+}
+
+/*!
+ *  \brief Parses the lines in [begin,end) and appends the normalized rows.
+ *  \return the number of lines in the chunk
+ */
+long TextParser::parseChunk(
+  const char *begin,
+  const char *end,
+  int D,
+  std::vector<long double> &values,
+  std::vector<struct ParseError> &errors
+) {
+  long line = 0;
+  string reason;
+  values.reserve((end - begin) / (D * 6) + D);
+  const char *p = begin;
+  while (p < end) {
+    const char *eol = static_cast<const char *>(memchr(p,'\n',end-p));
+    if (eol == NULL) eol = end;
+    line++;
+    size_t n = values.size();
+    values.resize(n + D);
+    int status = parseLine(p,eol,D,&values[n],reason);
+    if (status != 1) {
+      values.resize(n);
+      if (status < 0) {
+        struct ParseError error;
+        error.line = line;
+        error.reason = reason;
+        errors.push_back(error);
+      }
+    }
+    p = eol + 1;
+  }
+  return line;
+}
+
+/*!
+ *  \brief Parses one line of D numbers and normalizes it in place.
+ *  \return 1 if a row was parsed, 0 for a blank line, -1 if malformed
+ */
+int TextParser::parseLine(
+  const char *p,
+  const char *eol,
+  int D,
+  long double *x,
+  string &reason
+) {
+  int count = 0;
+  while (1) {
+    while (p < eol && isBlank(*p)) p++;
+    if (p == eol) break;
+    if (count == D) {
+      reason = "more than " + boost::lexical_cast<string>(D) + " values";
+      return -1;
+    }
+    if (*p == '+') p++;
+    double value;
+    std::from_chars_result result = std::from_chars(p,eol,value);
+    if (result.ec != std::errc() ||
+        (result.ptr < eol && !isBlank(*result.ptr))) {
+      const char *q = p;
+      while (q < eol && !isBlank(*q)) q++;
+      reason = "invalid number '" + string(p,q) + "'";
+      return -1;
+    }
+    x[count++] = value;
+    p = result.ptr;
+  }
+  if (count == 0) {
+    return 0;
+  }
+  if (count < D) {
+    reason = "expected " + boost::lexical_cast<string>(D) + " values, found "
+             + boost::lexical_cast<string>(count);
+    return -1;
+  }
+
+  long double normsq = 0;
+  for (int j=0; j<D; j++) {
+    normsq += x[j] * x[j];
+  }
+  if (normsq <= 0) {
+    reason = "zero vector";
+    return -1;
+  }
+  long double l2norm = sqrt(normsq);
+  for (int j=0; j<D; j++) {
+    x[j] /= l2norm;
+  }
+  return 1;
+}
+
@@ -0,0 +1,54 @@
+#ifndef TEXT_PARSER_H
+#define TEXT_PARSER_H
+
+#include "Header.h"
+
+#define MAX_REPORTED_ERRORS 10
+
+struct ParseError
+{
+  long line;                // 1-based line number in the file
+  string reason;
+};
+
+/*!
+ *  A whitespace separated text sample parsed into one contiguous
+ *  row-major buffer of unit vectors. D = 0 before parsing a buffer means
+ *  the dimensionality is taken from its first non-blank line.
+ */
+struct TextSample
+{
+  int D;
+  long N;
+  std::vector<long double> values;
+  std::vector<struct ParseError> errors;
+};
+
+/*!
+ *  Parses whitespace separated text files in parallel: the file is
+ *  split into chunks at newline boundaries, each chunk is parsed with
+ *  std::from_chars on its own thread and every row is normalized in
+ *  place. Lines that cannot be parsed are reported and skipped.
+ */
+class TextParser
+{
+  private:
+    int num_threads;
+
+    long parseChunk(const char *, const char *, int, std::vector<long double> &,
+                    std::vector<struct ParseError> &);
+
+    int parseLine(const char *, const char *, int, long double *, string &);
+
+  public:
+    TextParser();
+
+    TextParser(int);
+
+    bool parse(string &, struct TextSample &);
+
+    bool parse(const char *, size_t, struct TextSample &);
+};
+
+#endif
+
@@ -0,0 +1,150 @@
+#include "ThreadPool.h"
+
+// index of the pool worker running on this thread (-1 elsewhere)
+static thread_local int worker_index = -1;
+
+/*!
+ *  Null constructor: one worker per hardware thread
+ */
+ThreadPool::ThreadPool() : ThreadPool(std::thread::hardware_concurrency())
+{}
+
+ThreadPool::ThreadPool(int num_threads) : pending(0), next_queue(0), stop(false)
+{
+  if (num_threads < 1) num_threads = 1;
+  for (int i=0; i<num_threads; i++) {
+    queues.push_back(new TaskQueue);
+  }
+  for (int i=0; i<num_threads; i++) {
+    workers.push_back(std::thread(&ThreadPool::run,this,i));
+  }
+}
+
+/*!
+ *  \brief Finishes the queued tasks and joins the workers.
+ */
+ThreadPool::~ThreadPool()
+{
+  wait();
+  {
+    std::lock_guard<std::mutex> guard(idle_lock);
+    stop = true;
+  }
+  wake.notify_all();
+  for (int i=0; i<workers.size(); i++) {
+    workers[i].join();
+  }
+  for (int i=0; i<queues.size(); i++) {
+    delete queues[i];
+  }
+}
+
+int ThreadPool::size()
+{
+  return workers.size();
+}
+
+/*!
+ *  \brief Index of the worker running the calling thread, or -1
+ */
+int ThreadPool::currentWorker()
+{
+  return worker_index;
+}
+
+/*!
+ *  \brief Queues a task. A task submitted from a worker goes on that
+ *  worker's own deque; others are spread round robin.
+ */
+void ThreadPool::submit(const std::function<void()> &task)
+{
+  int q = worker_index;
+  if (q < 0 || q >= queues.size()) {
+    q = next_queue++ % queues.size();
+  }
+  pending++;
+  {
+    std::lock_guard<std::mutex> guard(queues[q]->lock);
+    queues[q]->tasks.push_back(task);
+  }
+  {
+    std::lock_guard<std::mutex> guard(idle_lock);
+  }
+  wake.notify_one();
+}
+
+/*!
+ *  \brief Blocks until every submitted task has finished. Called from a
+ *  worker, it runs queued tasks meanwhile instead of blocking.
+ */
+void ThreadPool::wait()
+{
+  if (worker_index >= 0) {
+    std::function<void()> task;
+    while (pending > 0) {
+      if (pop(worker_index,task) || steal(worker_index,task)) {
+        task();
+        if (--pending == 0) {
+          std::lock_guard<std::mutex> guard(idle_lock);
+          finished.notify_all();
+        }
+      } else {
+        std::this_thread::yield();
+      }
+    }
+    return;
+  }
+  std::unique_lock<std::mutex> guard(idle_lock);
+  finished.wait(guard,[this]{ return pending == 0; });
+}
+
+bool ThreadPool::pop(int id, std::function<void()> &task)
+{
+  std::lock_guard<std::mutex> guard(queues[id]->lock);
+  if (queues[id]->tasks.empty()) return false;
+  task = std::move(queues[id]->tasks.back());
+  queues[id]->tasks.pop_back();
+  return true;
+}
+
+bool ThreadPool::steal(int id, std::function<void()> &task)
+{
+  for (int i=1; i<queues.size(); i++) {
+    TaskQueue *victim = queues[(id + i) % queues.size()];
+    std::lock_guard<std::mutex> guard(victim->lock);
+    if (!victim->tasks.empty()) {
+      task = std::move(victim->tasks.front());
+      victim->tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+/*!
+ *  \brief Worker loop: own tasks first, then steal, then sleep until
+ *  more tasks are submitted.
+ */
+void ThreadPool::run(int id)
+{
+  worker_index = id;
+  std::function<void()> task;
+  while (1) {
+    if (pop(id,task) || steal(id,task)) {
+      task();
+      task = nullptr;
+      if (--pending == 0) {
+        std::lock_guard<std::mutex> guard(idle_lock);
+        finished.notify_all();
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> guard(idle_lock);
+    if (stop) break;
+    // pending counts tasks being run as well as queued ones; recheck the
+    // deques at least every millisecond in case a wake-up was missed
+    wake.wait_for(guard,std::chrono::milliseconds(1));
+    if (stop) break;
+  }
+}
+
@@ -0,0 +1,68 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include "Header.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <deque>
+#include <functional>
+
+/*!
+ *  Fixed set of worker threads with one task deque per worker. A worker
+ *  takes its own tasks from the back (most recently queued first) and,
+ *  when it runs out, steals from the front of the other deques, so
+ *  uneven tasks are balanced without a central queue.
+ */
+class ThreadPool
+{
+  private:
+    struct TaskQueue {
+      std::deque<std::function<void()> > tasks;
+      std::mutex lock;
+    };
+
+    std::vector<TaskQueue *> queues;
+
+    std::vector<std::thread> workers;
+
+    std::atomic<long> pending;    // tasks submitted and not yet finished
+
+    std::atomic<int> next_queue;  // round robin for tasks from other threads
+
+    std::mutex idle_lock;
+
+    std::condition_variable wake,finished;
+
+    bool stop;
+
+    bool pop(int, std::function<void()> &);
+
+    bool steal(int, std::function<void()> &);
+
+    void run(int);
+
+    ThreadPool(const ThreadPool &);
+
+    ThreadPool &operator=(const ThreadPool &);
+
+  public:
+    ThreadPool();
+
+    ThreadPool(int);
+
+    ~ThreadPool();
+
+    int size();
+
+    void submit(const std::function<void()> &);
+
+    void wait();
+
+    static int currentWorker();
+};
+
+#endif
+
@@ -0,0 +1,144 @@
+#include "WarmStartCache.h"
+#include "Statistics.h"
+
+/*!
+ *  Null constructor: WARM_START_CACHE_SIZE entries
+ */
+WarmStartCache::WarmStartCache() : capacity(WARM_START_CACHE_SIZE)
+{
+  clear();
+}
+
+WarmStartCache::WarmStartCache(int capacity) : capacity(capacity)
+{
+  assert(capacity > 0);
+  clear();
+}
+
+void WarmStartCache::clear()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  entries.clear();
+  clock = 0;
+  hits = 0;
+  misses = 0;
+}
+
+/*!
+ *  \brief The key of the statistics: \sum x / N and the upper triangle of
+ *  \sum x x' / N, which do not depend on the sample size.
+ */
+void WarmStartCache::computeKey(struct SufficientStatistics &stats, long double *key)
+{
+  int n = 0;
+  for (int i=0; i<3; i++) {
+    key[n++] = stats.sum_x[i] / stats.N;
+  }
+  for (int i=0; i<3; i++) {
+    for (int j=i; j<3; j++) {
+      key[n++] = stats.sum_xx(i,j) / stats.N;
+    }
+  }
+}
+
+/*!
+ *  \brief Finds the cached fit of the type whose key is nearest to that of
+ *  the statistics (largest absolute difference), if it is within 
+ *  WARM_START_DISTANCE / sqrt(N): the standard error of the key is of 
+ *  order 1/sqrt(N).
+ *  \param stats a reference to a SufficientStatistics (3D)
+ *  \param type the estimation type
+ *  \param estimates set to the cached estimates
+ *  \return false if no cached fit is close enough
+ */
+bool WarmStartCache::lookup(
+  struct SufficientStatistics &stats, string &type, struct Estimates &estimates
+) {
+  long double key[WARM_START_KEY_SIZE];
+  computeKey(stats,key);
+
+  std::lock_guard<std::mutex> guard(lock);
+  int nearest = -1;
+  long double min_distance = WARM_START_DISTANCE / sqrt(stats.N);
+  for (int i=0; i<entries.size(); i++) {
+    if (entries[i].type.compare(type) != 0) continue;
+    long double distance = 0;
+    for (int j=0; j<WARM_START_KEY_SIZE; j++) {
+      long double diff = fabs(key[j] - entries[i].key[j]);
+      if (diff > distance) distance = diff;
+    }
+    if (distance <= min_distance) {
+      min_distance = distance;
+      nearest = i;
+    }
+  }
+  if (nearest < 0) {
+    misses++;
+    return false;
+  }
+  hits++;
+  entries[nearest].last_used = ++clock;
+  estimates = entries[nearest].estimates;
+  return true;
+}
+
+/*!
+ *  \brief Caches a fit, replacing the least recently used entry when the
+ *  cache is full.
+ */
+void WarmStartCache::insert(
+  struct SufficientStatistics &stats, string &type, struct Estimates &estimates
+) {
+  struct Entry entry;
+  entry.type = type;
+  computeKey(stats,entry.key);
+  entry.estimates = estimates;
+
+  std::lock_guard<std::mutex> guard(lock);
+  entry.last_used = ++clock;
+  if (entries.size() < capacity) {
+    entries.push_back(entry);
+    return;
+  }
+  int oldest = 0;
+  for (int i=1; i<entries.size(); i++) {
+    if (entries[i].last_used < entries[oldest].last_used) {
+      oldest = i;
+    }
+  }
+  entries[oldest] = entry;
+}
+
+/*!
+ *  \brief Fits a Kent distribution to the statistics, warm started from 
+ *  the nearest cached fit if there is one (see computeEstimates()), and
+ *  caches the result.
+ *  \param stats a reference to a SufficientStatistics (3D)
+ *  \param type MOMENT, MLE_UNCONSTRAINED, MLE_CONSTRAINED, MLE_NEWTON, 
+ *  MML_SCALE or MML
+ *  \return the estimates
+ */
+struct Estimates WarmStartCache::estimate(struct SufficientStatistics &stats, string type)
+{
+  struct Estimates estimates,previous;
+  if (lookup(stats,type,previous)) {
+    estimates = computeEstimates(stats,type,previous);
+  } else {
+    estimates = computeEstimates(stats,type);
+  }
+  insert(stats,type,estimates);
+  return estimates;
+}
+
+long WarmStartCache::numHits()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  return hits;
+}
+
+long WarmStartCache::numMisses()
+{
+  std::lock_guard<std::mutex> guard(lock);
+  return misses;
+}
+
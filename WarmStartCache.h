@@ -0,0 +1,69 @@
+#ifndef WARM_START_CACHE_H
+#define WARM_START_CACHE_H
+
+#include "Header.h"
+#include "Support.h"
+
+#include <mutex>
+
+#define WARM_START_CACHE_SIZE 16
+#define WARM_START_DISTANCE 0.05  // largest distance of the normalized statistics (x sqrt(N))
+#define WARM_START_KEY_SIZE 9     // \sum x / N and the upper triangle of \sum x x' / N
+
+/*!
+ *  A small cache of recent fits keyed on the normalized sufficient
+ *  statistics (\sum x / N, \sum x x' / N). A fit of statistics close to
+ *  those of a cached fit (of the same type) is warm started from its
+ *  estimates, as when a sample is refitted after a few points were added.
+ *  Close means well within the sampling error of the statistics: 
+ *  bootstrap resamples differ by about one standard error, and for them
+ *  the moment estimates of their own data are the better start. The 
+ *  least recently used entry is replaced when the cache is full. Safe to
+ *  share between threads.
+ */
+class WarmStartCache
+{
+  private:
+    struct Entry {
+      string type;
+      long double key[WARM_START_KEY_SIZE];
+      struct Estimates estimates;
+      long last_used;
+    };
+
+    std::vector<struct Entry> entries;
+
+    int capacity;
+
+    long clock;
+
+    long hits,misses;
+
+    std::mutex lock;
+
+    static void computeKey(struct SufficientStatistics &, long double *);
+
+    WarmStartCache(const WarmStartCache &);
+
+    WarmStartCache &operator=(const WarmStartCache &);
+
+  public:
+    WarmStartCache();
+
+    WarmStartCache(int);
+
+    bool lookup(struct SufficientStatistics &, string &, struct Estimates &);
+
+    void insert(struct SufficientStatistics &, string &, struct Estimates &);
+
+    struct Estimates estimate(struct SufficientStatistics &, string);
+
+    long numHits();
+
+    long numMisses();
+
+    void clear();
+};
+
+#endif
+
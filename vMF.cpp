@@ -46,7 +46,7 @@ long double vMF::computeLogNormalizationConstant()
 {
   if (kappa < ZERO) {
     long double log_area = computeLogSurfaceAreaSphere(D);
-    return log_area;
+    return -log_area;   // uniform density 1/area
   } else {
     long double log_bessel = logModifiedBesselFirstKind(D/2.0-1,kappa);
     if (log_bessel >= INFINITY) {
@@ -59,16 +59,42 @@ long double vMF::computeLogNormalizationConstant()
       cout << scientific << "; log_bessel: " << log_bessel << endl;
       cout << "D: " << D << "; kappa: " << kappa << endl;
     }
+    long double log_norm;
     if (D == 2) {
-      long double log_cd = -log(2*PI) - log_bessel;
+      log_norm = -log(2*PI) - log_bessel;
     } else {
       long double log_tmp = (D/2.0) * log (kappa/(2*PI));
-      long double log_cd = log_tmp - log(kappa) - log_bessel;
+      log_norm = log_tmp - log(kappa) - log_bessel;
     }
-    return log_cd;
+    return log_norm;
   }
 }
 
+/*!
+ *  \brief This function estimates kappa from the mean resultant length
+ *  R = |\sum x| / N: the approximation of Banerjee et al.
+ *  k = R (D - R^2) / (1 - R^2), refined by Newton steps on
+ *  A_D(k) = I_(D/2)(k) / I_(D/2-1)(k) = R (Sra, 2012), with
+ *  A_D'(k) = 1 - A_D(k)^2 - (D-1) A_D(k) / k.
+ *  \param D the dimensionality
+ *  \param R the mean resultant length (0 < R < 1)
+ *  \return the estimate of kappa
+ */
+long double vMF::estimateKappa(int D, long double R)
+{
+  if (R <= 0) return 0;
+  if (R >= 1) return std::numeric_limits<long double>::infinity();
+  long double kappa = R * (D - R*R) / (1 - R*R);
+  for (int i=0; i<VMF_KAPPA_NEWTON_STEPS; i++) {
+    long double A = exp(logModifiedBesselFirstKind(D/2.0,kappa)
+                        - logModifiedBesselFirstKind(D/2.0-1,kappa));
+    long double next = kappa - (A - R) / (1 - A*A - (D-1) * A / kappa);
+    if (!(next > 0 && std::isfinite(next))) break;
+    kappa = next;
+  }
+  return kappa;
+}
+
 /*!
  *  \brief This function assigns a source vMF distribution.
  *  \param source a reference to a vMF
@@ -280,9 +306,22 @@ std::vector<Vector > vMF::generate(int sample_size)
     generateCanonical(canonical_sample,sample_size);
     if (fabs(mu[D-1] - 1) <= TOLERANCE) {  // check if mu is Z-axis
       return canonical_sample;
-    } else {
+    } else if (D == 3) {
       Matrix transformation = align_zaxis_with_vector(mu);
       return transform(canonical_sample,transformation);
+    } else {
+      // the Householder reflection H = I - 2 v v'/v'v, v = e_D - mu,
+      // takes e_D to mu in any dimension
+      Vector v(mu.size());
+      for (int i=0; i<D; i++) v[i] = -mu[i];
+      v[D-1] += 1;
+      long double vv = computeDotProduct(v,v);
+      for (int j=0; j<sample_size; j++) {
+        Vector &x = canonical_sample[j];
+        long double scale = 2 * computeDotProduct(v,x) / vv;
+        for (int i=0; i<D; i++) x[i] -= scale * v[i];
+      }
+      return canonical_sample;
     }
   } else if (sample_size == 0) {
     return std::vector<Vector>(); 
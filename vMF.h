@@ -3,6 +3,8 @@
 
 #include "Header.h"
 
+#define VMF_KAPPA_NEWTON_STEPS 2
+
 class vMF
 {
   private:
@@ -75,6 +77,9 @@ class vMF
     //! Generate a random canonical sample
     void generateCanonical(std::vector<Vector> &, int);
 
+    //! Estimates kappa from the mean resultant length
+    static long double estimateKappa(int, long double);
+
 };
 
 #endif
@@ -0,0 +1,323 @@
+#include "vMFMixture.h"
+#include "Support.h"
+
+/*!
+ *  Constructor: one thread per OpenMP thread
+ *  \param K the number of components
+ */
+vMFMixture::vMFMixture(int K) : K(K), D(0), num_threads(omp_get_max_threads()),
+                                num_points(0), log_likelihood(0), iterations(0),
+                                max_iterations(VMF_MIXTURE_MAX_ITERATIONS)
+{
+  assert(K >= 1);
+}
+
+vMFMixture::vMFMixture(int K, int num_threads) : vMFMixture(K)
+{
+  this->num_threads = (num_threads < 1) ? 1 : num_threads;
+}
+
+int vMFMixture::numThreads()
+{
+  return num_threads;
+}
+
+void vMFMixture::setMaxIterations(int max_iterations)
+{
+  this->max_iterations = (max_iterations < 1) ? 1 : max_iterations;
+}
+
+Vector vMFMixture::getWeights()
+{
+  return weights;
+}
+
+std::vector<vMF> vMFMixture::getComponents()
+{
+  std::vector<vMF> components;
+  for (int k=0; k<K; k++) {
+    components.push_back(vMF(means[k],kappas[k]));
+  }
+  return components;
+}
+
+/*!
+ *  \brief The log likelihood of the data at the last E-step
+ */
+long double vMFMixture::logLikelihood()
+{
+  return log_likelihood;
+}
+
+int vMFMixture::numIterations()
+{
+  return iterations;
+}
+
+/*!
+ *  \brief Fits the mixture to a sample of unit vectors.
+ *  \param sample a reference to a std::vector<Vector>
+ *  \return the number of EM iterations
+ */
+int vMFMixture::estimate(std::vector<Vector> &sample)
+{
+  num_points = sample.size();
+  D = (num_points > 0) ? sample[0].size() : 0;
+  points.resize(num_points * D);
+  for (long i=0; i<num_points; i++) {
+    for (int j=0; j<D; j++) {
+      points[i*D+j] = sample[i][j];
+    }
+  }
+  return run();
+}
+
+/*!
+ *  \brief Fits the mixture to D-dimensional unit vectors stored
+ *  contiguously (row-major, as accumulateStatistics()).
+ */
+int vMFMixture::estimate(const long double *x, long rows, int D)
+{
+  this->D = D;
+  num_points = rows;
+  points.assign(x,x + rows * D);
+  return run();
+}
+
+/*!
+ *  \brief EM from initialize() until the log likelihood changes by less
+ *  than VMF_MIXTURE_TOLERANCE per point.
+ */
+int vMFMixture::run()
+{
+  if (num_points < K || D < 2) {
+    cout << "Error: " << num_points << " points of dimension " << D << " for "
+         << K << " components ...\n";
+    return 0;
+  }
+  initialize();
+  std::vector<long double> sums,sizes;
+  long double previous = -std::numeric_limits<long double>::infinity();
+  for (iterations=1; ; iterations++) {
+    computeTerms();
+    log_likelihood = expectation(sums,sizes);
+    if (fabs(log_likelihood - previous) < VMF_MIXTURE_TOLERANCE * num_points ||
+        iterations == max_iterations) {
+      break;
+    }
+    previous = log_likelihood;
+    maximization(sums,sizes);
+  }
+  return iterations;
+}
+
+/*!
+ *  \brief log w_k f_k(x) = (log w_k + log C_D(k_k)) + x' (k_k mu_k)
+ */
+void vMFMixture::computeTerms()
+{
+  W.resize(D * K);
+  constants.resize(K);
+  for (int k=0; k<K; k++) {
+    vMF component(means[k],kappas[k]);
+    constants[k] = log(weights[k]) + component.getLogNormalizationConstant();
+    for (int d=0; d<D; d++) {
+      W[d*K+k] = kappas[k] * means[k][d];
+    }
+  }
+}
+
+/*!
+ *  \brief The E-step: the log densities of a tile of points (a block of
+ *  X W), their log-sum-exp and the responsibilities R, which are summed
+ *  (\sum_i r_ik) and multiplied into the statistics (X'R) of the thread.
+ *  \param sums the D x K weighted sums \sum_i r_ik x_i (row-major)
+ *  \param sizes the K sums \sum_i r_ik
+ *  \return the log likelihood
+ */
+long double vMFMixture::expectation(
+  std::vector<long double> &sums, std::vector<long double> &sizes
+) {
+  sums.assign(D * K,0);
+  sizes.assign(K,0);
+  long double total = 0;
+  long num_blocks = (num_points + VMF_MIXTURE_ROW_BLOCK - 1) / VMF_MIXTURE_ROW_BLOCK;
+  const double *w = &W[0], *c = &constants[0];
+
+  #pragma omp parallel num_threads(num_threads)
+  {
+    std::vector<double> tile(VMF_MIXTURE_ROW_BLOCK * K),S(D * K,0),n(K,0);
+    double *L = &tile[0], *s = &S[0];
+    long double local = 0;
+    #pragma omp for schedule(static)
+    for (long b=0; b<num_blocks; b++) {
+      long first = b * VMF_MIXTURE_ROW_BLOCK;
+      int rows = std::min((long) VMF_MIXTURE_ROW_BLOCK,num_points - first);
+      const double *X = &points[first * D];
+
+      // L = 1 c' + X W, one tile of dimensions at a time
+      for (int r=0; r<rows; r++) {
+        double *l = L + r * K;
+        #pragma omp simd
+        for (int k=0; k<K; k++) {
+          l[k] = c[k];
+        }
+      }
+      for (int d0=0; d0<D; d0+=VMF_MIXTURE_DIM_BLOCK) {
+        int d1 = std::min(d0 + VMF_MIXTURE_DIM_BLOCK,D);
+        for (int r=0; r<rows; r++) {
+          const double *x = X + r * D;
+          double *l = L + r * K;
+          for (int d=d0; d<d1; d++) {
+            double xd = x[d];
+            const double *wd = w + d * K;
+            #pragma omp simd
+            for (int k=0; k<K; k++) {
+              l[k] += xd * wd[k];
+            }
+          }
+        }
+      }
+
+      // responsibilities
+      double block_log_likelihood = 0;
+      for (int r=0; r<rows; r++) {
+        double *l = L + r * K;
+        double max = l[0];
+        for (int k=1; k<K; k++) {
+          max = (l[k] > max) ? l[k] : max;
+        }
+        double sum = 0;
+        for (int k=0; k<K; k++) {
+          l[k] = exp(l[k] - max);
+          sum += l[k];
+        }
+        block_log_likelihood += max + log(sum);
+        double inv = 1 / sum;
+        #pragma omp simd
+        for (int k=0; k<K; k++) {
+          l[k] *= inv;
+          n[k] += l[k];
+        }
+      }
+      local += block_log_likelihood;
+
+      // S += X' R, with the same tiles
+      for (int d0=0; d0<D; d0+=VMF_MIXTURE_DIM_BLOCK) {
+        int d1 = std::min(d0 + VMF_MIXTURE_DIM_BLOCK,D);
+        for (int r=0; r<rows; r++) {
+          const double *x = X + r * D;
+          const double *l = L + r * K;
+          for (int d=d0; d<d1; d++) {
+            double xd = x[d];
+            double *sd = s + d * K;
+            #pragma omp simd
+            for (int k=0; k<K; k++) {
+              sd[k] += xd * l[k];
+            }
+          }
+        }
+      }
+    }
+    #pragma omp critical
+    {
+      total += local;
+      for (int i=0; i<D*K; i++) {
+        sums[i] += S[i];
+      }
+      for (int k=0; k<K; k++) {
+        sizes[k] += n[k];
+      }
+    }
+  }
+  return total;
+}
+
+/*!
+ *  \brief The M-step: w_k = \sum_i r_ik / N, mu_k the direction of
+ *  \sum_i r_ik x_i and kappa_k from its mean resultant length. A component
+ *  left with less than VMF_MIXTURE_MIN_SIZE points keeps its parameters.
+ */
+void vMFMixture::maximization(std::vector<long double> &sums, std::vector<long double> &sizes)
+{
+  #pragma omp parallel for num_threads(num_threads) schedule(dynamic)
+  for (int k=0; k<K; k++) {
+    weights[k] = sizes[k] / num_points;
+    if (sizes[k] < VMF_MIXTURE_MIN_SIZE) continue;
+    long double length = 0;
+    for (int d=0; d<D; d++) {
+      length += sums[d*K+k] * sums[d*K+k];
+    }
+    length = sqrt(length);
+    if (!(length > 0)) continue;
+    for (int d=0; d<D; d++) {
+      means[k][d] = sums[d*K+k] / length;
+    }
+    long double R = length / sizes[k];
+    if (R > 1 - TOLERANCE) R = 1 - TOLERANCE;
+    kappas[k] = vMF::estimateKappa(D,R);
+  }
+}
+
+/*!
+ *  \brief Seeds the means at K points picked as in k-means++ (each next
+ *  seed with probability proportional to 1 - max cos to the seeds so
+ *  far) and runs VMF_MIXTURE_SEED_ITERATIONS rounds of spherical k-means:
+ *  E-steps with equal weights and kappa VMF_MIXTURE_SEED_KAPPA, after
+ *  which only the means move. The first M-step then sets the weights and
+ *  kappas.
+ */
+void vMFMixture::initialize()
+{
+  std::vector<long> seeds(1,rand() % num_points);
+  std::vector<double> distance(num_points,2);
+  for (int s=1; s<K; s++) {
+    const double *y = &points[seeds[s-1] * D];
+    double total = 0;
+    #pragma omp parallel for num_threads(num_threads) reduction(+:total)
+    for (long i=0; i<num_points; i++) {
+      const double *x = &points[i * D];
+      double dot = 0;
+      #pragma omp simd reduction(+:dot)
+      for (int d=0; d<D; d++) {
+        dot += x[d] * y[d];
+      }
+      if (1 - dot < distance[i]) distance[i] = 1 - dot;
+      total += distance[i];
+    }
+    double u = total * rand() / (double) RAND_MAX;
+    long next = 0;
+    for (; next<num_points-1; next++) {
+      u -= distance[next];
+      if (u <= 0) break;
+    }
+    seeds.push_back(next);
+  }
+
+  means.assign(K,Vector(D,0));
+  for (int k=0; k<K; k++) {
+    for (int d=0; d<D; d++) {
+      means[k][d] = points[seeds[k] * D + d];
+    }
+  }
+  std::vector<long double> sums,sizes;
+  for (int iter=0; iter<VMF_MIXTURE_SEED_ITERATIONS; iter++) {
+    weights = Vector(K,1.0/K);
+    kappas = Vector(K,VMF_MIXTURE_SEED_KAPPA);
+    computeTerms();
+    expectation(sums,sizes);
+    for (int k=0; k<K; k++) {
+      long double length = 0;
+      for (int d=0; d<D; d++) {
+        length += sums[d*K+k] * sums[d*K+k];
+      }
+      length = sqrt(length);
+      if (!(length > 0)) continue;
+      for (int d=0; d<D; d++) {
+        means[k][d] = sums[d*K+k] / length;
+      }
+    }
+  }
+  maximization(sums,sizes);
+}
+
@@ -0,0 +1,89 @@
+#ifndef VMF_MIXTURE_H
+#define VMF_MIXTURE_H
+
+#include "Header.h"
+#include "vMF.h"
+
+#define VMF_MIXTURE_MAX_ITERATIONS 500
+#define VMF_MIXTURE_TOLERANCE 1e-7     // change of the log likelihood per point
+#define VMF_MIXTURE_MIN_SIZE 2         // smallest (weighted) size refitted
+#define VMF_MIXTURE_ROW_BLOCK 64       // points per tile of the E-step
+#define VMF_MIXTURE_DIM_BLOCK 256      // dimensions per tile of the E-step
+#define VMF_MIXTURE_SEED_KAPPA 100     // concentration of the initial assignment
+#define VMF_MIXTURE_SEED_ITERATIONS 5  // spherical k-means rounds before EM
+
+/*!
+ *  A mixture of von Mises-Fisher distributions in D dimensions (D up to
+ *  several hundred: normalized embeddings) fitted by EM.
+ *  E-step: the log densities of all the points under all the components
+ *  are the matrix product X W (N x D times D x K, W = [k_1 mu_1 ...
+ *  k_K mu_K]) plus log w_k + log C_D(k_k). It is computed in tiles of
+ *  VMF_MIXTURE_ROW_BLOCK points by VMF_MIXTURE_DIM_BLOCK dimensions, so
+ *  that a tile of W stays in cache while the points of the tile run
+ *  through it, with the innermost loop (SIMD) over the components. The
+ *  responsibilities R of a tile are folded into the statistics X'R of
+ *  the thread by the same tiling and are never stored for all points.
+ *  M-step: mu_k is the direction of \sum_i r_ik x_i and kappa_k comes from
+ *  the mean resultant length (vMF::estimateKappa()).
+ */
+class vMFMixture
+{
+  private:
+    int K;
+
+    int D;
+
+    int num_threads;
+
+    std::vector<double> points;    // row-major, D per point
+
+    long num_points;
+
+    Vector weights;
+
+    std::vector<Vector> means;
+
+    Vector kappas;
+
+    std::vector<double> W;         // D x K: kappa_k mu_k, row-major
+
+    std::vector<double> constants; // K: log w_k + log C_D(kappa_k)
+
+    long double log_likelihood;
+
+    int iterations,max_iterations;
+
+    int run();
+
+    void computeTerms();
+
+    long double expectation(std::vector<long double> &, std::vector<long double> &);
+
+    void maximization(std::vector<long double> &, std::vector<long double> &);
+
+    void initialize();
+
+  public:
+    vMFMixture(int);
+
+    vMFMixture(int, int);
+
+    void setMaxIterations(int);
+
+    int estimate(std::vector<Vector> &);
+
+    int estimate(const long double *, long, int);
+
+    Vector getWeights();
+
+    std::vector<vMF> getComponents();
+
+    long double logLikelihood();
+
+    int numIterations();
+
+    int numThreads();
+};
+
+#endif
+